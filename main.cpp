@@ -1,980 +1,6757 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <cstdlib>  // strtol for the batch mode options
 #include <fstream>
+#include <sstream>
 #include <chrono>   
 #include <thread>   // For Running multiple traffic simulations at a time
 #include <ctime>    // To handle time in simulations
+#include <atomic>   // For publishing graph snapshots to readers without locks
+#include <mutex>
+#include <condition_variable>
+#include <algorithm> // sort for the scenario statistics
+#include <limits>
+#ifdef __linux__
+#include <pthread.h> // Pinning region workers to CPUs
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h> // Routing service over a Unix domain socket
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#define HAVE_UNIX_SOCKETS 1
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> // AVX2 relaxation kernel
+#endif
 
 using namespace std;
 
+const int MAX_PHASES = 4; // Signal phases per intersection
+const int DEFAULT_RED_DURATION = 30; // Red time added to the green when no cycle length is given
+const int DEFAULT_ROAD_CAPACITY = 3; // Vehicles a road holds when road_network.csv doesn't say
+const int DEFAULT_DISCHARGE_RATE = 1; // Vehicles per second crossing the stop line on green
+const int MAX_ROAD_COUNT = 65535; // Capacities and discharge rates are stored in 16 bits
+const int MAX_THREADS = 256; // Most threads a service, the load generator, a scenario run or a benchmark starts
+
+/* Node IDs and road weights have the width of the deployment profile, fixed at
+ compile time. The default build uses 32-bit IDs and weights. Building with
+ -DTRAFFIC_PROFILE_CITY stores both in 16 bits, for networks of up to 65,535
+ intersections with travel times up to 65,534 s, and roughly halves the
+ memory of every road. RoutingTraits gives each pair of widths the distance
+ type that holds any path length it allows, and the distance and weight
+ sentinels of the routing kernels*/
+template <typename NodeT, typename WeightT> struct RoutingTraits;
+
+template <> struct RoutingTraits<int, int> { // Weights stay below 2^30, so a distance plus a weight fits an int
+    typedef int Distance;
+    static const int INF = 0x3fffffff;
+    static const int BLOCKED = 0x3fffffff;
+};
+
+template <> struct RoutingTraits<unsigned short, unsigned short> { // A path has at most 65,535 roads of at most 65,534 s, below 2^32
+    typedef unsigned int Distance;
+    static const unsigned int INF = 0xffffffffu;
+    static const unsigned short BLOCKED = 0xffff;
+};
+
+#ifdef TRAFFIC_PROFILE_CITY
+typedef unsigned short NodeId;
+typedef unsigned short Weight;
+#else
+typedef int NodeId;
+typedef int Weight;
+#endif
+typedef RoutingTraits<NodeId, Weight>::Distance Distance;
+const int MAX_NODES = numeric_limits<NodeId>::max(); // Intersections a build can hold
+
 struct Nodes {
     string name; // Intersection name
-    int timing;  // Green light timing
-
-    Nodes() : name(""), timing(0) {} 
-    Nodes(string n, int t) : name(n), timing(t) {} 
+    int timing;  // Green light timing (of the first phase)
+    int offset;  // Start of the first phase within the cycle
+    int cycle;   // Length of the whole signal cycle
+    int numPhases; // Phases run back to back from the offset, the rest of the cycle is red for all
+    int phaseGreen[MAX_PHASES]; // Green time of each phase, incoming roads take turns over the phases
+
+    Nodes() : name(""), timing(0), offset(0), cycle(DEFAULT_RED_DURATION), numPhases(1), phaseGreen{0} {} 
+    Nodes(string n, int t, int o = 0) : name(n), timing(t), offset(o), cycle(t + DEFAULT_RED_DURATION), numPhases(1), phaseGreen{t} {} 
 };
 
 struct Edges {
-    Nodes* from; // Starting point of the road
-    Nodes* to;   // Ending point of the road
-    int weight;  // Weight or time for the road
-    int capacity; // Max limit for vehicles
+    NodeId from; // Index of the starting intersection of the road
+    NodeId to;   // Index of the ending intersection of the road
+    Weight weight;  // Weight or time for the road
+    unsigned short capacity; // Max limit for vehicles, the storage of the road's queue
+    unsigned short discharge; // Vehicles per second leaving the road while the light is green
     bool isActive; // If the road is operational
 
-    Edges() : from(nullptr), to(nullptr), weight(0), capacity(3), isActive(true) {} // Default constructor
-    Edges(Nodes* f, Nodes* t, int w) : from(f), to(t), weight(w), capacity(3), isActive(true) {} // Constructor with values
+    Edges() : from(0), to(0), weight(0), capacity(DEFAULT_ROAD_CAPACITY), discharge(DEFAULT_DISCHARGE_RATE), isActive(true) {} // Default constructor
+    Edges(int f, int t, Weight w, int c = DEFAULT_ROAD_CAPACITY, int d = DEFAULT_DISCHARGE_RATE)
+        : from(static_cast<NodeId>(f)), to(static_cast<NodeId>(t)), weight(w), capacity(static_cast<unsigned short>(c)),
+          discharge(static_cast<unsigned short>(d)), isActive(true) {} // Constructor with values
 };
 
-struct VehiclesNode {
-    string ID; // Vehicle ID
-    Edges* edge; // The road it is on
-    string priorityLevel; // Vehicles Priority e.g Ambulance might have a higher priority
-
-    VehiclesNode() : edge(NULL), ID("") {} 
-    VehiclesNode(string id, Edges* e, string p) : ID(id), edge(e), priorityLevel(p) {} 
-};
+unsigned int fnvHash(const char* bytes, int length, unsigned int hash = 2166136261u) { // FNV-1a, pass a previous result to continue it
+    for (int i = 0; i < length; i++) hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 16777619u;
+    return hash;
+}
 
-class Graph {
-private:
-    Nodes* intersections; // Array of intersections
-    Edges* streets; // Array of roads, for example if from has A and To has D than the street will be from A to D
-    int numNodes; // Current number of intersections
-    int numEdges; // Current number of roads
-    int nodeCapacity; // Maximum number of intersections
-    int edgeCapacity; // Maximum number of roads
-    int* vehicleCounts; // Number of vehicles per road
-    int hashTableSize; // Size of the hash table
+enum VehiclePriority { PRIORITY_LOW, PRIORITY_HIGH }; // High is for emergency vehicles e.g Ambulance
 
-    void resizeNodes() {   // increasing capacity of intersection
-        nodeCapacity *= 2; 
-        Nodes* temp = new Nodes[nodeCapacity]; // Create a new larger array
-        for (int i = 0; i < numNodes; i++) temp[i] = intersections[i]; 
-        delete[] intersections; // Free old memory
-        intersections = temp; // Update to new array
+/* All vehicles of the system, one array per field so a pass over a single
+ field (positions during the simulation, say) reads contiguous memory. The
+ arrays double when full, so adding n vehicles copies O(n) entries in total.
+ IDs are packed into one character pool and found through a hash index*/
+struct FleetStore {
+    int size;
+    int capacity;
+    int* origin;            // Node index of the start intersection, -1 once it was deleted
+    int* destination;       // Node index of the end intersection
+    unsigned char* priority; // A VehiclePriority
+    int* position;          // Hop of its route the vehicle has reached
+    int* departureTime;     // When it leaves its current intersection
+    int* idStart;           // ID of vehicle i is idPool[idStart[i] .. idStart[i + 1] - 1]
+    char* idPool;
+    int poolCapacity;
+    int* idIndex;           // Open addressing table: hash slot -> vehicle, -1 if empty
+    int indexCapacity;      // Power of two, at least twice the number of vehicles
+
+    FleetStore() : size(0), capacity(0), origin(nullptr), destination(nullptr), priority(nullptr), position(nullptr),
+                   departureTime(nullptr), idStart(new int[1]), idPool(nullptr), poolCapacity(0), idIndex(nullptr), indexCapacity(0) {
+        idStart[0] = 0;
+        reserve(16);
     }
 
-    void resizeEdges() { // Increase capacity of roads array
-        edgeCapacity *= 2; 
-        Edges* temp = new Edges[edgeCapacity]; 
-        for (int i = 0; i < numEdges; i++) temp[i] = streets[i];
-        delete[] streets;
-        streets = temp; 
+    ~FleetStore() {
+        delete[] origin;
+        delete[] destination;
+        delete[] priority;
+        delete[] position;
+        delete[] departureTime;
+        delete[] idStart;
+        delete[] idPool;
+        delete[] idIndex;
     }
 
-    int hashFunction(const string& fromName, const string& toName) {
-        /* Simple hash function using the
-         sum of ASCII values of the names*/
-        int hash = 0;
-        for (char c : fromName) hash += c;
-        for (char c : toName) hash += c;
-        return hash % hashTableSize;
+    FleetStore(const FleetStore&) = delete;
+    FleetStore& operator=(const FleetStore&) = delete;
+
+    template <typename T>
+    static void grow(T*& array, int used, int newCapacity) {
+        T* grown = new T[newCapacity];
+        for (int i = 0; i < used; i++) grown[i] = array[i];
+        delete[] array;
+        array = grown;
     }
 
-public:
-    Graph() : intersections(nullptr), streets(nullptr), numNodes(0), numEdges(0), nodeCapacity(10), edgeCapacity(10), vehicleCounts(nullptr), hashTableSize(100) {
-        intersections = new Nodes[nodeCapacity]; // Initialize intersections with initial capacity of 10
-        streets = new Edges[edgeCapacity]; // Initialize roads....
-        vehicleCounts = new int[hashTableSize]; // Initialize vehicle counts...
-        for (int i = 0; i < hashTableSize; i++) vehicleCounts[i] = 0; // Initialize all counts to 0
+    static unsigned int hashId(const char* id, int length) {
+        return fnvHash(id, length);
     }
 
-    ~Graph() { // For memory release
-        delete[] intersections; // Free intersections array
-        delete[] streets; // Free roads array
-        delete[] vehicleCounts; // Free vehicle counts
+    void rebuildIndex(int newCapacity) {
+        delete[] idIndex;
+        idIndex = new int[newCapacity];
+        indexCapacity = newCapacity;
+        for (int i = 0; i < indexCapacity; i++) idIndex[i] = -1;
+        for (int v = 0; v < size; v++) {
+            unsigned int slot = hashId(idPool + idStart[v], idStart[v + 1] - idStart[v]) & (indexCapacity - 1);
+            while (idIndex[slot] != -1) slot = (slot + 1) & (indexCapacity - 1);
+            idIndex[slot] = v;
+        }
     }
-     int getnumEdges() {
-    return numEdges;  // Just returning the number of edges here.
+
+    void reserve(int count) { // Room for count vehicles without further copies
+        if (count > capacity) {
+            grow(origin, size, count);
+            grow(destination, size, count);
+            grow(priority, size, count);
+            grow(position, size, count);
+            grow(departureTime, size, count);
+            grow(idStart, size + 1, count + 1);
+            capacity = count;
+        }
+        int wanted = indexCapacity > 0 ? indexCapacity : 32;
+        while (wanted < 2 * count) wanted *= 2;
+        if (wanted != indexCapacity) rebuildIndex(wanted);
     }
 
-    Edges getStreets(int i) {
-        return streets[i];  // Returning the street of required index
+    int find(const string& id) { // Vehicle with this ID, or -1
+        int length = static_cast<int>(id.size());
+        unsigned int slot = hashId(id.data(), length) & (indexCapacity - 1);
+        while (idIndex[slot] != -1) {
+            int v = idIndex[slot];
+            if (idStart[v + 1] - idStart[v] == length && memcmp(idPool + idStart[v], id.data(), length) == 0) return v;
+            slot = (slot + 1) & (indexCapacity - 1);
+        }
+        return -1;
     }
 
-    Nodes* findNode(const string& name) {
-        for (int i = 0; i < numNodes; i++) {  // looping through all nodes to find desired one
-            if (intersections[i].name == name) {
-                  return &intersections[i]; 
-            }
+    /* Appends a vehicle and returns its index, or -1 if the ID is taken*/
+    int add(const string& id, int from, int to, VehiclePriority level) {
+        if (find(id) != -1) return -1;
+        if (size == capacity) reserve(capacity * 2);
+        int length = static_cast<int>(id.size());
+        if (idStart[size] + length > poolCapacity) {
+            int newPoolCapacity = poolCapacity > 0 ? poolCapacity * 2 : 256;
+            while (newPoolCapacity < idStart[size] + length) newPoolCapacity *= 2;
+            grow(idPool, idStart[size], newPoolCapacity);
+            poolCapacity = newPoolCapacity;
         }
-    return nullptr;  // If not found
+        memcpy(idPool + idStart[size], id.data(), length);
+        idStart[size + 1] = idStart[size] + length;
+        origin[size] = from;
+        destination[size] = to;
+        priority[size] = static_cast<unsigned char>(level);
+        position[size] = 0;
+        departureTime[size] = 0;
+
+        unsigned int slot = hashId(id.data(), length) & (indexCapacity - 1);
+        while (idIndex[slot] != -1) slot = (slot + 1) & (indexCapacity - 1);
+        idIndex[slot] = size;
+        return size++;
     }
 
-    int findEdgeIndex(const string& fromName, const string& toName) {
-            for (int i = 0; i < numEdges; i++) {  // Searching for the edge with the matching 'from' and 'to' names.
-                if (streets[i].from->name == fromName && streets[i].to->name == toName) {
-                    return i;  
-                }
-            }
-    return -1;  // if not found.
+    string idOf(int v) const {
+        return string(idPool + idStart[v], idStart[v + 1] - idStart[v]);
     }
 
-    void incrementVehicleCount(const string& fromName, const string& toName) {
-            int index = hashFunction(fromName, toName);  // First, find the index of the edge.
-            vehicleCounts[index]++;  // If the edge exists, increment the vehicle count.
-        }
+    static VehiclePriority parsePriority(const string& level) {
+        return level == "High" ? PRIORITY_HIGH : PRIORITY_LOW;
+    }
 
-    void decrementVehicleCount(const string& fromName, const string& toName) {
-        int index = hashFunction(fromName, toName);  // Find the index of the edge.
-        if (vehicleCounts[index] > 0) {
-            vehicleCounts[index]--;  // Decrease the vehicle count if it's above 0.
-        }
+    const char* priorityName(int v) const {
+        return priority[v] == PRIORITY_HIGH ? "High" : "Low";
+    }
+};
+
+template <typename Key>
+struct MinHeap { // Key is the distance type for searches, int for event times
+    Key* keys;  // Priority of each entry (distance so far)
+    int* items; // Node index stored with each entry
+    int size;   // Number of entries in the heap
+    int capacity; // Allocated size of the arrays
+
+    MinHeap(int cap) : keys(nullptr), items(nullptr), size(0), capacity(cap > 0 ? cap : 1) {
+        keys = new Key[capacity];
+        items = new int[capacity];
     }
 
-    bool isCongested(const string& fromName, const string& toName) {
-        int index = hashFunction(fromName, toName);  // again finding edge's index first.
-        return vehicleCounts[index] >= streets[findEdgeIndex(fromName, toName)].capacity;  // Return true if the vehicles are more than or equal to capacity.
+    ~MinHeap() {
+        delete[] keys;
+        delete[] items;
     }
 
-    int findNodeIndex(const string& name) {
-        for (int i = 0; i < numNodes; i++) {  // Searching through nodes by name.
-            if (intersections[i].name == name) {
-                 return i;  // Return the index if found.
+    MinHeap(const MinHeap&) = delete; // The heap owns its arrays, so no copies
+    MinHeap& operator=(const MinHeap&) = delete;
+
+    bool empty() const { return size == 0; }
+    void clear() { size = 0; }
+
+    void push(Key key, int item) {
+        if (size == capacity) { // Double the arrays when full
+            Key* newKeys = new Key[capacity * 2];
+            int* newItems = new int[capacity * 2];
+            for (int i = 0; i < size; i++) {
+                newKeys[i] = keys[i];
+                newItems[i] = items[i];
             }
+            delete[] keys;
+            delete[] items;
+            keys = newKeys;
+            items = newItems;
+            capacity *= 2;
         }
-        return -1;  // if not found.
+        int i = size++;
+        while (i > 0) { // Sift the new entry up to its place
+            int parent = (i - 1) / 2;
+            if (keys[parent] <= key) break;
+            keys[i] = keys[parent];
+            items[i] = items[parent];
+            i = parent;
+        }
+        keys[i] = key;
+        items[i] = item;
     }
 
-    Nodes** bfs(const string& startName, const string& endName) {
-        const int MAX_NODES = 100;
-        Nodes* queue[MAX_NODES];
-        Nodes* parent[MAX_NODES];
-        bool visited[MAX_NODES] = {false};  // Array to track nodes that were already visited.
-        int front = 0, rear = 0;  // Queue pointers for BFS.
-
-        Nodes* startNode = findNode(startName);  // Find the starting node.
-        Nodes* endNode = findNode(endName);  // Find the destination node.
-        if (startNode == nullptr || endNode == nullptr) {
-            return nullptr;  // If either node is not found, return null.
+    void pop(Key& key, int& item) { // Remove the entry with the smallest key
+        key = keys[0];
+        item = items[0];
+        size--;
+        Key lastKey = keys[size];
+        int lastItem = items[size];
+        int i = 0;
+        while (2 * i + 1 < size) { // Sift the last entry down from the root
+            int child = 2 * i + 1;
+            if (child + 1 < size && keys[child + 1] < keys[child]) child++;
+            if (lastKey <= keys[child]) break;
+            keys[i] = keys[child];
+            items[i] = items[child];
+            i = child;
         }
+        keys[i] = lastKey;
+        items[i] = lastItem;
+    }
+};
 
-        int startIndex = findNodeIndex(startName);
-        int endIndex = findNodeIndex(endName);
+/* Immutable copy of the road network in compact adjacency (CSR) form. Writers
+ publish a new snapshot after every edit; readers pin one for a whole query, so
+ they never see an array that is being edited or reallocated*/
+template <typename NodeT, typename WeightT>
+struct BasicGraphSnapshot {
+    long long version; // Graph version this snapshot was published as
+    int numNodes;
+    int numEdges;
+    Nodes* nodes;   // Copy of the intersections
+    int* firstOut;  // Out-edges of node u are slots firstOut[u] .. firstOut[u + 1] - 1
+    NodeT* tail;    // From node of each edge slot
+    NodeT* head;    // To node of each edge slot
+    WeightT* weight;      // Travel time of each edge slot
+    WeightT* routeWeight; // Travel time, or BLOCKED when the road is closed
+    int* edgeId;    // Index of the road in the streets array at publish time
+    unsigned short* storage;   // Vehicles the road holds before it spills back
+    unsigned short* discharge; // Vehicles per second leaving the road on green
+    unsigned char* approachPhase; // Signal phase that serves vehicles arriving over this slot
+    int* signalCycle;   // Cycle length of the signal at the slot's head
+    int* signalBase;    // Start of the slot's wait table in waitTable
+    int* waitTable;     // waitTable[signalBase[e] + t % signalCycle[e]] = wait when arriving at time t
+
+    BasicGraphSnapshot(int n, int m) : version(0), numNodes(n), numEdges(m), waitTable(nullptr) {
+        nodes = new Nodes[n > 0 ? n : 1];
+        firstOut = new int[n + 1];
+        tail = new NodeT[m > 0 ? m : 1];
+        head = new NodeT[m > 0 ? m : 1];
+        weight = new WeightT[m > 0 ? m : 1];
+        routeWeight = new WeightT[m > 0 ? m : 1];
+        edgeId = new int[m > 0 ? m : 1];
+        storage = new unsigned short[m > 0 ? m : 1];
+        discharge = new unsigned short[m > 0 ? m : 1];
+        approachPhase = new unsigned char[m > 0 ? m : 1];
+        signalCycle = new int[m > 0 ? m : 1];
+        signalBase = new int[m > 0 ? m : 1];
+    }
 
-        queue[rear++] = startNode;  // Add the start node to the queue.
-        visited[startIndex] = true;  // Mark the start node as visited.
-        parent[startIndex] = nullptr;
+    ~BasicGraphSnapshot() {
+        delete[] nodes;
+        delete[] firstOut;
+        delete[] tail;
+        delete[] head;
+        delete[] weight;
+        delete[] routeWeight;
+        delete[] edgeId;
+        delete[] storage;
+        delete[] discharge;
+        delete[] approachPhase;
+        delete[] signalCycle;
+        delete[] signalBase;
+        delete[] waitTable;
+    }
 
-        while (front != rear) {  // Standard BFS loop.
-        Nodes* current = queue[front++];  // Dequeue the next node.
-        int currentIndex = findNodeIndex(current->name);
+    BasicGraphSnapshot(const BasicGraphSnapshot&) = delete; // Snapshots are shared by pointer only
+    BasicGraphSnapshot& operator=(const BasicGraphSnapshot&) = delete;
 
-        if (current == endNode) {  // If we've reached the destination, build the path.
-                int pathLength = 0;
-                Nodes* path[MAX_NODES];
-                Nodes* node = endNode;
-                while (node != nullptr) {
-                    path[pathLength++] = node;
-                    node = parent[findNodeIndex(node->name)];
-                }
-                Nodes** result = new Nodes*[pathLength + 1];
-                for (int i = 0; i < pathLength; i++) {
-                    result[i] = path[pathLength - 1 - i];  // Reverse the path to get the correct order.
-                }
-                result[pathLength] = nullptr;  // Null-terminate the result.
-                return result;
-            }
+    bool isOpen(int e) const { return routeWeight[e] != RoutingTraits<NodeT, WeightT>::BLOCKED; } // Closed roads carry BLOCKED
+};
 
-        for (int i = 0; i < numEdges; i++) {  // Loop through all edges to find unvisited neighbors.
-                if (streets[i].from == current && streets[i].isActive && !visited[findNodeIndex(streets[i].to->name)]) {
-                    Nodes* neighbor = streets[i].to;
-                    int neighborIndex = findNodeIndex(neighbor->name);
-                    queue[rear++] = neighbor;  // Enqueue the neighbor.
-                    visited[neighborIndex] = true;  // Mark as visited.
-                    parent[neighborIndex] = current;  // Set the parent node.
-                }
+typedef BasicGraphSnapshot<NodeId, Weight> GraphSnapshot;
+
+/* Wait tables of one signal: table[p * cycle + t] is the wait of a vehicle
+ arriving for phase p at time t of the cycle. The phases turn green one after
+ the other, the first one offset seconds into the cycle*/
+void fillSignalWaitTable(int* table, int cycle, int offset, const int* greens, int numPhases) {
+    int phaseStart = 0;
+    for (int p = 0; p < numPhases; p++) {
+        int* phaseTable = table + p * cycle;
+        int phaseEnd = phaseStart + greens[p];
+        for (int t = 0; t < cycle; t++) {
+            int pos = ((t - offset) % cycle + cycle) % cycle; // Time since the first phase started
+            if (pos >= phaseStart && pos < phaseEnd) phaseTable[t] = 0;
+            else if (pos < phaseStart) phaseTable[t] = phaseStart - pos;
+            else phaseTable[t] = cycle - pos + phaseStart;
+        }
+        phaseStart = phaseEnd;
+    }
+}
+
+struct BucketLists { // Linked lists of node entries, one list per bucket
+    int* head;       // First entry of each bucket, -1 if empty
+    int* entryNode;  // Node of each entry
+    int* entryNext;  // Next entry in the same bucket
+    int numBuckets;
+    int numEntries;
+    int capacity;
+    int live;        // Entries pushed but not taken yet
+
+    BucketLists(int buckets, int cap) : numBuckets(buckets), numEntries(0), capacity(cap > 0 ? cap : 1), live(0) {
+        head = new int[numBuckets];
+        for (int b = 0; b < numBuckets; b++) head[b] = -1;
+        entryNode = new int[capacity];
+        entryNext = new int[capacity];
+    }
+
+    ~BucketLists() {
+        delete[] head;
+        delete[] entryNode;
+        delete[] entryNext;
+    }
+
+    BucketLists(const BucketLists&) = delete;
+    BucketLists& operator=(const BucketLists&) = delete;
+
+    void push(int bucket, int node) {
+        if (numEntries == capacity) { // Entries are never reused, so just grow the pool
+            capacity *= 2;
+            int* newNodes = new int[capacity];
+            int* newNext = new int[capacity];
+            for (int i = 0; i < numEntries; i++) {
+                newNodes[i] = entryNode[i];
+                newNext[i] = entryNext[i];
             }
+            delete[] entryNode;
+            delete[] entryNext;
+            entryNode = newNodes;
+            entryNext = newNext;
         }
-        return nullptr;  // Return null if no path is found.
+        entryNode[numEntries] = node;
+        entryNext[numEntries] = head[bucket];
+        head[bucket] = numEntries++;
+        live++;
     }
 
-    void createNode(const string& name, int timings) {
-        if (findNode(name) != nullptr) {  // Check if the node already exists.
-            cout << "Node with the name '" << name << "' already exists!" << endl;
-            return;
-        }   
+    int take(int bucket) { // Detach a bucket's whole list and return its first entry
+        int first = head[bucket];
+        head[bucket] = -1;
+        return first;
+    }
+};
 
-        if (numNodes == nodeCapacity) {  // Resize the array if needed.
-            resizeNodes();
+struct ThreadBarrier { // Blocks until all threads of a parallel search reach it
+    mutex lock;
+    condition_variable released;
+    int numThreads;
+    int waiting;
+    int generation; // Counts how often the barrier opened
+
+    ThreadBarrier(int threads) : numThreads(threads), waiting(0), generation(0) {}
+
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        int myGeneration = generation;
+        if (++waiting == numThreads) { // Last one in opens the barrier
+            waiting = 0;
+            generation++;
+            released.notify_all();
+        } else {
+            released.wait(guard, [&]() { return generation != myGeneration; });
         }
+    }
+};
 
-        intersections[numNodes++] = Nodes(name, timings);  // Add the new node.
-        cout << "Node '" << name << "' has been added." << endl;
+/* Bounded ring buffer between exactly one producer thread and one consumer
+ thread. Each side only writes its own index, so no locks are needed; a full
+ queue makes tryPush fail (leaving the item alone) and the producer decides
+ how to wait. Items are moved in and out, not copied*/
+template <typename T>
+struct SpscQueue {
+    T* slots;
+    unsigned int capacity;     // Power of two
+    atomic<unsigned int> head; // Next slot to pop, written by the consumer
+    atomic<unsigned int> tail; // Next slot to push, written by the producer
+    atomic<int> highWater;     // Most entries ever queued at once
+
+    SpscQueue(unsigned int cap) : capacity(1), head(0), tail(0), highWater(0) {
+        while (capacity < cap) capacity *= 2;
+        slots = new T[capacity];
     }
 
-    void createEdges(const string& from, const string& to, int weight) {
-        Nodes* fromNode = findNode(from);
-        Nodes* toNode = findNode(to);
+    ~SpscQueue() {
+        delete[] slots;
+    }
 
-        if (fromNode && toNode) {  // Check if both nodes exist.
-            for (int i = 0; i < numEdges; i++) {  // Check if the edge already exists.
-                if (streets[i].from == fromNode && streets[i].to == toNode) {
-                    cout << "Edge from '" << from << "' to '" << to << "' already exists. Updating weight to " << weight << "." << endl;
-                    streets[i].weight = weight;  // Update the weight if the edge is found.
-                    return;
-                }
-            }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool tryPush(T& item) {
+        unsigned int t = tail.load(memory_order_relaxed);
+        unsigned int used = t - head.load(memory_order_acquire);
+        if (used == capacity) return false;
+        slots[t & (capacity - 1)] = move(item);
+        tail.store(t + 1, memory_order_release);
+        if (static_cast<int>(used + 1) > highWater.load(memory_order_relaxed)) highWater.store(used + 1, memory_order_relaxed);
+        return true;
+    }
 
-        if (numEdges == edgeCapacity) {  // Resize if needed.
-            resizeEdges();
-        }
-        streets[numEdges++] = Edges(fromNode, toNode, weight);  // Add the new edge.
-        cout << "Edge from '" << from << "' to '" << to << "' with weight " << weight << " has been added." << endl;
-        }
-        else {
-        cout << "Error: One or both nodes not found!" << endl;
-        }
+    bool tryPop(T& item) {
+        unsigned int h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) return false;
+        item = move(slots[h & (capacity - 1)]);
+        head.store(h + 1, memory_order_release);
+        return true;
     }
 
-    void inputNodes() {
-        cout << "Enter node names (type -1 to stop):" << endl;
-        string name;
-        int timings;
-        while (true) {
-            cout << "Enter node name: ";
-            cin >> name;
-            if (name == "-1") break;  // Break if user types -1.
-            cout << "Enter Green Time: ";
-            cin >> timings;
-            createNode(name, timings);  // Create the node and store in the file.
-            ofstream file("traffic_signal_timings.csv", std::ios::app);
-            file << name << ',' << timings << endl; 
-            file.close();
-        }
+    int sizeApprox() const {
+        return static_cast<int>(tail.load(memory_order_acquire) - head.load(memory_order_acquire));
     }
+};
 
-    void inputEdges() {
-        cout << "Enter edges in the format: from to weight (type -1 to stop):" << endl;
-        string from, to;
-        int weight;
-        while (true) {
-            cout << "Enter edge (from to weight): ";
-            cin >> from;
-            if (from == "-1") break;  // Stop if -1 is typed.
-            cin >> to >> weight;
-            createEdges(from, to, weight);  // Create the edge and store in the file.
-            ofstream file("road_network.csv", std::ios::app);
-            file << from << "," << to << "," << weight << endl; 
-            file.close();
+/* FIFO queues of all roads in one pool. Road e owns a ring of storage[e]
+ entries starting at pool[start[e]], so the queues take exactly the storage
+ of the network and a tick walks through contiguous memory*/
+struct RoadQueues {
+    int numRoads;
+    int* start; // Ring of road e is pool[start[e] .. start[e + 1] - 1]
+    int* head;  // Position of the front vehicle in the ring
+    int* count; // Vehicles on the road
+    int* pool;  // Vehicle indices
+    bool* held; // Front vehicle is waiting for room on its next road
+
+    RoadQueues(const unsigned short* storage, int n) : numRoads(n) {
+        start = new int[n + 1];
+        head = new int[n > 0 ? n : 1];
+        count = new int[n > 0 ? n : 1];
+        held = new bool[n > 0 ? n : 1];
+        start[0] = 0;
+        for (int e = 0; e < n; e++) {
+            start[e + 1] = start[e] + storage[e];
+            head[e] = 0;
+            count[e] = 0;
+            held[e] = false;
         }
+        pool = new int[start[n] > 0 ? start[n] : 1];
     }
 
-    void displayGraph() {
-        cout << "Nodes:" << endl;
-        for (int i = 0; i < numNodes; i++) {
-            cout << i << ": " << intersections[i].name << endl;  // Display each node.
-        }
+    ~RoadQueues() {
+        delete[] start;
+        delete[] head;
+        delete[] count;
+        delete[] pool;
+        delete[] held;
+    }
 
-        cout << "Edges:" << endl;
-        for (int i = 0; i < numEdges; i++) {
-            cout << i << ": " << streets[i].from->name << " -> "
-            << streets[i].to->name
-            << " (Weight: " << streets[i].weight << ")" << endl;  // Display each edge.
-        }
+    RoadQueues(const RoadQueues&) = delete;
+    RoadQueues& operator=(const RoadQueues&) = delete;
+
+    int storage(int e) const { return start[e + 1] - start[e]; }
+    bool full(int e) const { return count[e] == storage(e); }
+    int front(int e) const { return pool[start[e] + head[e]]; }
+
+    int at(int e, int k) const { // k-th vehicle from the front
+        int i = head[e] + k;
+        if (i >= storage(e)) i -= storage(e);
+        return pool[start[e] + i];
     }
 
+    void push(int e, int vehicle) {
+        int i = head[e] + count[e];
+        if (i >= storage(e)) i -= storage(e);
+        pool[start[e] + i] = vehicle;
+        count[e]++;
+    }
 
-    void DeleteNode(const string& name) {
-        Nodes* node = findNode(name); // First, find the node
-        if (node == nullptr) {
-            cout << "Node not found!" << endl; // If node is not found, show error and return
-            return;
-        }
+    void pop(int e) {
+        if (++head[e] == storage(e)) head[e] = 0;
+        count[e]--;
+        held[e] = false;
+    }
 
-        int i = 0;
-        while (i < numEdges) { // Loop through all edges to remove the ones connected to this node
-            if (streets[i].from == node || streets[i].to == node) {
-                for (int j = i; j < numEdges - 1; j++) {
-                    streets[j] = streets[j + 1]; // Shift edges to remove the deleted one
-                }
-                numEdges--; // Reduce the edge count
-            } else {
-                i++; // If no match, move to the next edge
-            }
-        }
+    int queued() const {
+        int total = 0;
+        for (int e = 0; e < numRoads; e++) total += count[e];
+        return total;
+    }
+};
 
-        int nodeIndex = -1;
-        for (int i = 0; i < numNodes; i++) {
-            if (intersections[i].name == name) {
-                nodeIndex = i; // Get the index of the node to be deleted
-                break;
-            }
+const int CONGESTION_BUCKETS = 5; // Occupancy histogram: under 25%, 50%, 75%, 100%, and full
+const int CONGESTION_WINDOW = 60; // Seconds of occupancy history the monitor keeps
+const int CONGESTION_TOP = 5; // Worst roads shown while a simulation runs
+const int CONGESTION_THRESHOLD = 80; // Mean occupancy percent over the window that counts as congested
+
+/* Sliding-window occupancy of every road of a RoadQueues. Each road keeps a
+ ring of its occupancy percent for the last window ticks (one byte per tick),
+ a histogram of that ring and its sum, which is the road's congestion score.
+ Only roads whose count changed within the last window ticks are sampled:
+ the ring of any other road holds one value, so nothing in it can change.
+ Roads with a score above 0 sit in a max-heap that is updated as the scores
+ change, so the worst K roads take O(K log K) and the roads over a threshold
+ O(roads reported) to list. Heap entries carry their score, so sifting never
+ looks anything up per road*/
+struct CongestionMonitor {
+    const RoadQueues& queues;
+    int window;               // Ticks of history, at most 255 so the histogram counts fit a byte
+    unsigned char* samples;   // samples[t % window * numRoads + e] = occupancy percent of road e at tick t
+    unsigned char* histogram; // histogram[e * CONGESTION_BUCKETS + b] = ticks of the window in bucket b
+    unsigned short* score;    // Sum of the road's ring, window * 100 when it was full all along
+    int* lastChange;          // Tick the road's count last changed
+    int* active;              // Roads still sampled every tick
+    int numActive;
+    int* activePos;           // Index in active, -1 when the road's ring holds one value
+    unsigned long long* heap; // Roads with a score above 0 as score << 32 | ~road, largest first
+    int* heapPos;             // Index in heap, -1 when not in it
+    int heapSize;
+    int* scratch;             // Stack of overThreshold
+    bool* dirty;              // Marks roads whose ring changed, for checkpoints (optional)
+
+    CongestionMonitor(const RoadQueues& q, int w)
+        : queues(q), window(w < 1 ? 1 : (w > 255 ? 255 : w)), numActive(0), heapSize(0), dirty(nullptr) {
+        int n = q.numRoads > 0 ? q.numRoads : 1;
+        samples = new unsigned char[static_cast<long long>(n) * window];
+        histogram = new unsigned char[n * CONGESTION_BUCKETS];
+        score = new unsigned short[n];
+        lastChange = new int[n];
+        active = new int[n];
+        activePos = new int[n];
+        heap = new unsigned long long[n];
+        heapPos = new int[n];
+        scratch = new int[n];
+        memset(samples, 0, static_cast<long long>(n) * window);
+        for (int e = 0; e < n; e++) { // Empty roads all along
+            for (int b = 0; b < CONGESTION_BUCKETS; b++) histogram[e * CONGESTION_BUCKETS + b] = 0;
+            histogram[e * CONGESTION_BUCKETS] = static_cast<unsigned char>(window);
+            score[e] = 0;
+            lastChange[e] = 0;
+            activePos[e] = heapPos[e] = -1;
         }
+    }
 
-        if (nodeIndex != -1) {
-            for (int i = nodeIndex; i < numNodes - 1; i++) { // Shift nodes to fill the gap of the deleted node
-                intersections[i] = intersections[i + 1];
-            }
-            numNodes--; // Reduce the node count
-        }
+    ~CongestionMonitor() {
+        delete[] samples;
+        delete[] histogram;
+        delete[] score;
+        delete[] lastChange;
+        delete[] active;
+        delete[] activePos;
+        delete[] heap;
+        delete[] heapPos;
+        delete[] scratch;
+    }
 
-        /* Update the node and 
-        edge files after deletion*/
-        updateNodeFile(name);
-        updateEdgeFile(name);
-        cout << "Node " << name << " and its associated edges have been deleted." << endl;
+    CongestionMonitor(const CongestionMonitor&) = delete;
+    CongestionMonitor& operator=(const CongestionMonitor&) = delete;
+
+    void changed(int e, int now) { // The count of road e changed during tick now
+        lastChange[e] = now;
+        if (activePos[e] != -1) return;
+        activePos[e] = numActive;
+        active[numActive++] = e;
     }
 
-    void traffic_signal_timings() {
-        ifstream file1("traffic_signal_timings.csv");
-        string node;
-        int timings;
-        if (file1.good()) {
-            string header;
-            getline(file1, header); // Skip the header row
-        }
-        
-        while (file1.good()) {
-            getline(file1, node, ','); // Read node name
-            file1 >> timings;
-            file1.ignore(__LONG_MAX__, '\n'); // Move to the next line
-            if (!node.empty()) {
-                createNode(node, timings); // Create node with the read data
+    void sample(int now) { // Called once at the end of every tick
+        unsigned char* ring = samples + static_cast<long long>(now % window) * queues.numRoads; // Oldest sample of every road
+        for (int i = 0; i < numActive; i++) {
+            int e = active[i];
+            int storage = queues.storage(e);
+            int percent = storage > 0 ? queues.count[e] * 100 / storage : 0;
+            int old = ring[e];
+            if (percent != old) {
+                ring[e] = static_cast<unsigned char>(percent);
+                histogram[e * CONGESTION_BUCKETS + bucketOf(old)]--;
+                histogram[e * CONGESTION_BUCKETS + bucketOf(percent)]++;
+                score[e] = static_cast<unsigned short>(score[e] + percent - old);
+                updateHeap(e);
+                if (dirty != nullptr) dirty[e] = true;
+            }
+            if (now - lastChange[e] + 1 >= window) { // Its ring holds one value now
+                int last = active[--numActive];
+                active[i] = last;
+                activePos[last] = i;
+                activePos[e] = -1;
+                i--;
             }
         }
     }
 
-    void road_Network() {
-        ifstream file("road_network.csv");
-        string from_node, to_node;
-        int weight;
-
-        if (file.good()) {
-            string header;
-            getline(file, header); // Skip the header row
+    /* Rebuilds the histograms, scores, heap and sampled roads from the rings
+     and lastChange, after a checkpoint filled those in as they were at the
+     end of tick now. The heap may come out in another layout, but every
+     query on it answers the same*/
+    void restore(int now) {
+        numActive = 0;
+        heapSize = 0;
+        for (int e = 0; e < queues.numRoads; e++) {
+            for (int b = 0; b < CONGESTION_BUCKETS; b++) histogram[e * CONGESTION_BUCKETS + b] = 0;
+            int sum = 0;
+            for (int t = 0; t < window; t++) {
+                int percent = samples[static_cast<long long>(t) * queues.numRoads + e];
+                histogram[e * CONGESTION_BUCKETS + bucketOf(percent)]++;
+                sum += percent;
+            }
+            score[e] = static_cast<unsigned short>(sum);
+            activePos[e] = heapPos[e] = -1;
+            if (score[e] > 0) updateHeap(e);
+            if (now - lastChange[e] + 1 < window) { // sample() hasn't let go of it yet
+                activePos[e] = numActive;
+                active[numActive++] = e;
+            }
         }
+    }
 
-        while (file.good()) {
-            getline(file, from_node, ','); 
-            getline(file, to_node, ','); 
-            file >> weight; 
-            file.ignore(__LONG_MAX__, '\n'); // Move to the next line
-            if (!from_node.empty() && !to_node.empty()) {
-                createEdges(from_node, to_node, weight); // Create edge with the read data
-            }
+    int worst(int k, int* roads) const { // Up to k roads with the highest score, worst first, ties by road number
+        int found = 0;
+        if (heapSize == 0 || k <= 0) return 0;
+        MinHeap<long long> candidates(2 * k + 1); // Heap positions keyed by minus their entry
+        candidates.push(-static_cast<long long>(heap[0]), 0);
+        while (found < k && !candidates.empty()) {
+            long long key;
+            int i;
+            candidates.pop(key, i);
+            roads[found++] = roadOf(heap[i]);
+            for (int c = 2 * i + 1; c <= 2 * i + 2 && c < heapSize; c++) candidates.push(-static_cast<long long>(heap[c]), c);
         }
-        file.close();
+        return found;
     }
 
-    Edges* findEdge(Nodes* from, Nodes* to) {
-        for (int i = 0; i < numEdges; i++) { // Find the edge that connects two nodes
-            if (streets[i].from == from && streets[i].to == to) {
-                return &streets[i]; // Return the edge if found
-            }
+    /* Roads whose mean occupancy over the window is at least percent. Writes
+     up to maxRoads of them, in heap order, and returns how many there are*/
+    int overThreshold(int percent, int* roads, int maxRoads) {
+        unsigned long long threshold = static_cast<unsigned long long>(percent * window > 0 ? percent * window : 1) << 32;
+        int found = 0, depth = 0;
+        if (heapSize > 0) scratch[depth++] = 0;
+        while (depth > 0) { // Below an entry under the threshold every entry is under it too
+            int i = scratch[--depth];
+            if (heap[i] < threshold) continue;
+            if (found < maxRoads) roads[found] = roadOf(heap[i]);
+            found++;
+            if (2 * i + 1 < heapSize) scratch[depth++] = 2 * i + 1;
+            if (2 * i + 2 < heapSize) scratch[depth++] = 2 * i + 2;
         }
-        return nullptr; // if no edge is found
+        return found;
+    }
+
+    int meanPercent(int e) const { return score[e] / window; }
+    int fullTicks(int e) const { return histogram[e * CONGESTION_BUCKETS + CONGESTION_BUCKETS - 1]; }
+
+    static int bucketOf(int percent) { return percent >= 100 ? CONGESTION_BUCKETS - 1 : percent / 25; }
+    static int roadOf(unsigned long long entry) { return static_cast<int>(~static_cast<unsigned int>(entry)); }
+
+    void place(int i, unsigned long long entry) {
+        heap[i] = entry;
+        heapPos[roadOf(entry)] = i;
+    }
+
+    void updateHeap(int e) { // Score of road e changed
+        unsigned long long entry = static_cast<unsigned long long>(score[e]) << 32 | ~static_cast<unsigned int>(e);
+        int i = heapPos[e];
+        if (i == -1) { // Score went up from 0
+            i = heapSize++;
+        } else if (score[e] == 0) { // Take it out, the last entry fills the gap
+            heapPos[e] = -1;
+            entry = heap[--heapSize];
+            if (i == heapSize) return;
+        }
+        while (i > 0 && heap[(i - 1) / 2] < entry) { // Sift up, or else down
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        while (true) {
+            int child = 2 * i + 1;
+            if (child >= heapSize) break;
+            if (child + 1 < heapSize && heap[child + 1] > heap[child]) child++;
+            if (heap[child] < entry) break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, entry);
+    }
+};
+
+/* Vehicles driven through RoadQueues. Route of vehicle v is the snapshot
+ slots hopSlot[hopStart[v] .. hopStart[v + 1] - 1]; position is the hop it
+ is on, -1 while it waits at its origin and the hop count once it arrived*/
+struct QueueFleet {
+    int size;
+    const int* hopStart;
+    const int* hopSlot;
+    int* position;
+    int* readyTime;           // When it reaches the stop line of its road
+    const unsigned char* priority; // A VehiclePriority, emergency vehicles don't stop at red lights
+    int* pending;             // Vehicles still at their origin, in the order they get to enter
+    int numPending;
+    bool* dirty;              // Marks moved vehicles (optional)
+    bool* dirtyRoad;          // Marks roads whose queue or hold changed (optional)
+    int* occupancy;           // Vehicles per road hash (optional)
+    const int* occupancySlot; // Occupancy index of each slot
+    CongestionMonitor* monitor; // Occupancy history of the roads (optional)
+};
+
+struct QueueStats {
+    long long entered;
+    long long moved;      // Vehicles that went on to their next road
+    long long arrived;
+    long long redStops;
+    long long spillbacks; // Times a road's front vehicle got held because the next road was full
+    int longestQueue;
+
+    QueueStats() : entered(0), moved(0), arrived(0), redStops(0), spillbacks(0), longestQueue(0) {}
+};
+
+struct ByteBuffer { // Growable byte array that checkpoints are serialized into
+    char* data;
+    int size;
+    int capacity;
+
+    ByteBuffer() : data(new char[256]), size(0), capacity(256) {}
+
+    ~ByteBuffer() {
+        delete[] data;
+    }
+
+    ByteBuffer(const ByteBuffer&) = delete;
+    ByteBuffer& operator=(const ByteBuffer&) = delete;
+
+    void clear() { size = 0; }
+
+    void append(const void* bytes, int count) {
+        if (size + count > capacity) { // Double until it fits
+            int newCapacity = capacity * 2;
+            while (newCapacity < size + count) newCapacity *= 2;
+            char* grown = new char[newCapacity];
+            memcpy(grown, data, size);
+            delete[] data;
+            data = grown;
+            capacity = newCapacity;
+        }
+        memcpy(data + size, bytes, count);
+        size += count;
+    }
+
+    void putInt(int value) { append(&value, sizeof(int)); }
+    void putInts(const int* values, int count) { append(values, count * static_cast<int>(sizeof(int))); }
+    void putLong(long long value) { append(&value, sizeof(long long)); }
+
+    void putVarint(unsigned int value) { // 7 bits per byte, small values take one byte
+        char bytes[5];
+        int count = 0;
+        while (value >= 0x80) {
+            bytes[count++] = static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        bytes[count++] = static_cast<char>(value);
+        append(bytes, count);
+    }
+};
+
+struct ByteReader { // Reads back what a ByteBuffer holds, failing instead of reading past the end
+    const char* data;
+    int size;
+    int pos;
+
+    ByteReader(const char* d, int s) : data(d), size(s), pos(0) {}
+
+    bool getInts(int* values, int count) {
+        if (count < 0 || count > (size - pos) / static_cast<int>(sizeof(int))) return false;
+        memcpy(values, data + pos, count * sizeof(int));
+        pos += count * static_cast<int>(sizeof(int));
+        return true;
+    }
+
+    bool getInt(int& value) { return getInts(&value, 1); }
+
+    bool getBytes(void* bytes, int count) {
+        if (count < 0 || count > size - pos) return false;
+        memcpy(bytes, data + pos, count);
+        pos += count;
+        return true;
+    }
+
+    bool getLong(long long& value) {
+        if (size - pos < static_cast<int>(sizeof(long long))) return false;
+        memcpy(&value, data + pos, sizeof(long long));
+        pos += static_cast<int>(sizeof(long long));
+        return true;
+    }
+
+    bool getVarint(unsigned int& value) {
+        value = 0;
+        for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(data[pos++]);
+            value |= static_cast<unsigned int>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+};
+
+/* A route as the snapshot slots of its roads, in driving order, with its
+ length kept next to them. The slots belong to the snapshot of version, so
+ a hop's travel time or signal is one array read and the intersections are
+ origin followed by the heads of the roads. Routes own their slots and are
+ moved, never copied (clone() makes an explicit copy)*/
+struct Route {
+    int* edges;
+    int length;        // Roads, the route passes length + 1 intersections
+    int origin;        // Start node, -1 when no route was found
+    long long version; // Snapshot the slots belong to
+
+    Route() : edges(nullptr), length(0), origin(-1), version(-1) {}
+
+    Route(int roads, int start, long long snapshotVersion) : edges(new int[roads > 0 ? roads : 1]), length(roads), origin(start), version(snapshotVersion) {}
+
+    ~Route() {
+        delete[] edges;
+    }
+
+    Route(Route&& other) : edges(other.edges), length(other.length), origin(other.origin), version(other.version) {
+        other.edges = nullptr;
+        other.length = 0;
+        other.origin = -1;
+    }
+
+    Route& operator=(Route&& other) {
+        if (this != &other) {
+            delete[] edges;
+            edges = other.edges;
+            length = other.length;
+            origin = other.origin;
+            version = other.version;
+            other.edges = nullptr;
+            other.length = 0;
+            other.origin = -1;
+        }
+        return *this;
+    }
+
+    Route(const Route&) = delete;
+    Route& operator=(const Route&) = delete;
+
+    bool found() const { return origin != -1; }
+
+    int node(const GraphSnapshot* snap, int i) const { return i == 0 ? origin : snap->head[edges[i - 1]]; } // i-th intersection
+
+    Route clone() const {
+        Route copy(length, origin, version);
+        for (int i = 0; i < length; i++) copy.edges[i] = edges[i];
+        return copy;
+    }
+
+    /* Stores the route delta-encoded: consecutive roads of a route usually sit
+     close in the slot order, so each difference takes a byte or two*/
+    void encode(ByteBuffer& buffer) const {
+        buffer.putInt(origin);
+        buffer.putVarint(static_cast<unsigned int>(length));
+        int previous = 0;
+        for (int i = 0; i < length; i++) {
+            int delta = edges[i] - previous;
+            buffer.putVarint((static_cast<unsigned int>(delta) << 1) ^ static_cast<unsigned int>(delta >> 31)); // Zigzag, small negatives stay small
+            previous = edges[i];
+        }
+    }
+
+    bool decode(ByteReader& reader, const GraphSnapshot* snap) { // Fails unless it is a connected route of snap
+        unsigned int roads;
+        int start;
+        if (!reader.getInt(start) || !reader.getVarint(roads)) return false;
+        if (start == -1 && roads == 0) {
+            *this = Route();
+            return true;
+        }
+        if (start < 0 || start >= snap->numNodes || roads > static_cast<unsigned int>(snap->numEdges)) return false;
+        Route decoded(static_cast<int>(roads), start, snap->version);
+        int previous = 0, at = start;
+        for (int i = 0; i < decoded.length; i++) {
+            unsigned int zigzag;
+            if (!reader.getVarint(zigzag)) return false;
+            int e = previous + static_cast<int>((zigzag >> 1) ^ (0u - (zigzag & 1)));
+            if (e < 0 || e >= snap->numEdges || snap->tail[e] != at) return false;
+            decoded.edges[i] = e;
+            previous = e;
+            at = snap->head[e];
+        }
+        *this = move(decoded);
+        return true;
+    }
+};
+
+Route routeFromPredecessors(const GraphSnapshot* snap, int src, int dst, const int* predEdge) { // Walks predEdge back from dst
+    int roads = 0;
+    for (int v = dst; v != src; v = snap->tail[predEdge[v]]) roads++;
+    Route route(roads, src, snap->version);
+    for (int v = dst; v != src; v = snap->tail[predEdge[v]]) route.edges[--roads] = predEdge[v];
+    return route;
+}
+
+struct TripRequest { // One parsed line of a trip stream
+    string ID;
+    string start;
+    string end;
+    int departure;    // Simulation second the vehicle wants to leave
+    unsigned char priority; // A VehiclePriority
+    Route route;      // Filled in by the router, not found if unreachable
+
+    TripRequest() : departure(0), priority(PRIORITY_LOW) {}
+};
+
+const int CHECKPOINT_MAGIC = 0x4b435354; // "TSCK"
+const int CHECKPOINT_FULL = 0;  // Record holding the whole simulation state, starts a new file
+const int CHECKPOINT_DELTA = 1; // Record holding only what changed since the previous record, appended
+const int CHECKPOINT_HEADER_INTS = 4; // Magic, type, payload size, checksum
+
+/* Writes checkpoint records on a background thread so the simulation tick
+ doesn't wait for the disk. There are two buffers: the tick serializes into
+ one while the thread writes the other. If the thread is still busy when the
+ next checkpoint is due, the tick skips it and tries again later.
+ A full record goes to a temporary file that then replaces the checkpoint,
+ so a crash never leaves a half written base; deltas are appended*/
+struct CheckpointWriter {
+    string path;
+    ByteBuffer buffers[2];
+    int filling;       // Buffer the tick serializes into next
+    bool pending;      // The other buffer is queued or being written
+    bool pendingFull;
+    bool stopping;
+    int recordsWritten;
+    int recordsSkipped;
+    bool failed;
+    mutex lock;
+    condition_variable wake;
+    thread worker;
+
+    CheckpointWriter(const string& file) : path(file), filling(0), pending(false), pendingFull(false), stopping(false),
+                                           recordsWritten(0), recordsSkipped(0), failed(false) {
+        worker = thread([this]() { run(); });
+    }
+
+    ~CheckpointWriter() {
+        finish();
+    }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    bool busy() {
+        lock_guard<mutex> guard(lock);
+        return pending;
+    }
+
+    ByteBuffer& begin(int type) { // Buffer for the next record, only valid while the writer isn't busy
+        ByteBuffer& buffer = buffers[filling];
+        buffer.clear();
+        int header[CHECKPOINT_HEADER_INTS] = {CHECKPOINT_MAGIC, type, 0, 0}; // Size and checksum are filled in by the thread
+        buffer.putInts(header, CHECKPOINT_HEADER_INTS);
+        return buffer;
+    }
+
+    void submit(bool full) { // Hand the filled buffer to the thread
+        lock_guard<mutex> guard(lock);
+        pending = true;
+        pendingFull = full;
+        filling ^= 1;
+        wake.notify_one();
+    }
+
+    void waitIdle() {
+        while (busy()) this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    void finish() {
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopping) return;
+            stopping = true;
+            wake.notify_one();
+        }
+        worker.join();
+    }
+
+    void run() {
+        while (true) {
+            bool full;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [this]() { return pending || stopping; });
+                if (!pending) return; // Stopping and nothing left to write
+                full = pendingFull;
+            }
+            ByteBuffer& buffer = buffers[filling ^ 1];
+            int* header = reinterpret_cast<int*>(buffer.data);
+            int payloadSize = buffer.size - CHECKPOINT_HEADER_INTS * static_cast<int>(sizeof(int));
+            header[2] = payloadSize;
+            header[3] = static_cast<int>(fnvHash(buffer.data + buffer.size - payloadSize, payloadSize));
+
+            bool ok;
+            if (full) {
+                string temp = path + ".tmp";
+                ofstream out(temp, ios::binary | ios::trunc);
+                out.write(buffer.data, buffer.size);
+                out.close();
+                ok = !out.fail() && rename(temp.c_str(), path.c_str()) == 0;
+            } else {
+                ofstream out(path, ios::binary | ios::app);
+                out.write(buffer.data, buffer.size);
+                out.close();
+                ok = !out.fail();
+            }
+
+            lock_guard<mutex> guard(lock);
+            if (ok) recordsWritten++;
+            else failed = true;
+            pending = false;
+        }
+    }
+};
+
+/* Routing kernels work on the snapshot's routeWeight array, where closed roads
+ carry ROUTE_BLOCKED. A relaxation only accepts weights in [minWeight, maxWeight],
+ so closed roads are skipped by the same compare that delta-stepping uses to
+ split light and heavy roads. A sum du + weight is only formed for open roads
+ from reached nodes, so it always fits a Distance*/
+const Distance ROUTE_INF = RoutingTraits<NodeId, Weight>::INF;
+const Weight ROUTE_BLOCKED = RoutingTraits<NodeId, Weight>::BLOCKED;
+const Weight ROUTE_MAX_WEIGHT = ROUTE_BLOCKED - 1;
+const int BACKEND_DIJKSTRA = 0;       // One-to-all backends
+const int BACKEND_DELTA_STEPPING = 1;
+
+/* Relax the out-edge slots [begin, end) of a node at distance du: every slot whose
+ weight is in range and gives a shorter distance updates dist and predEdge of its
+ head, and the head is appended to improved. Returns how many heads were appended*/
+typedef int (*RelaxKernel)(Distance du, int begin, int end, const NodeId* head, const Weight* weight, Weight minWeight,
+                           Weight maxWeight, Distance* dist, int* predEdge, int* improved);
+
+template <typename NodeT, typename WeightT>
+int relaxEdgesScalar(typename RoutingTraits<NodeT, WeightT>::Distance du, int begin, int end, const NodeT* head, const WeightT* weight,
+                     WeightT minWeight, WeightT maxWeight, typename RoutingTraits<NodeT, WeightT>::Distance* dist, int* predEdge, int* improved) {
+    int count = 0;
+    for (int e = begin; e < end; e++) {
+        WeightT w = weight[e];
+        if (w < minWeight || w > maxWeight) continue; // Closed road or outside the delta range
+        int v = head[e];
+        typename RoutingTraits<NodeT, WeightT>::Distance candidate = du + w;
+        if (candidate < dist[v]) {
+            dist[v] = candidate;
+            predEdge[v] = e;
+            improved[count++] = v;
+        }
+    }
+    return count;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNEL 1
+
+/* AVX2 version: gathers the heads' distances eight slots at a time and compares
+ all candidates at once. Lanes that pass are then written in slot order with the
+ scalar compare repeated, so two slots to the same head give exactly the scalar
+ result (a write only lowers dist, so a lane that failed can't pass later).
+ 16-bit heads and weights are widened as they are loaded, and the unsigned
+ distances of that profile are compared with their top bits flipped*/
+__attribute__((target("avx2")))
+int relaxEdgesAVX2(Distance du, int begin, int end, const NodeId* head, const Weight* weight, Weight minWeight, Weight maxWeight,
+                   Distance* dist, int* predEdge, int* improved) {
+    int count = 0;
+    int e = begin;
+    const __m256i base = _mm256_set1_epi32(static_cast<int>(du));
+    const __m256i lowest = _mm256_set1_epi32(minWeight);
+    const __m256i highest = _mm256_set1_epi32(maxWeight);
+#ifdef TRAFFIC_PROFILE_CITY
+    const __m256i flip = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+#endif
+    for (; e + 8 <= end; e += 8) {
+#ifdef TRAFFIC_PROFILE_CITY
+        __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + e)));
+        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(head + e)));
+        __m256i current = _mm256_xor_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(dist), v, 4), flip);
+        __m256i candidate = _mm256_xor_si256(_mm256_add_epi32(base, w), flip);
+#else
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight + e));
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(head + e));
+        __m256i current = _mm256_i32gather_epi32(dist, v, 4);
+        __m256i candidate = _mm256_add_epi32(base, w);
+#endif
+        __m256i better = _mm256_cmpgt_epi32(current, candidate);
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lowest, w), _mm256_cmpgt_epi32(w, highest));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(outside, better)));
+        while (mask != 0) { // Write the passing lanes in slot order
+            int lane = __builtin_ctz(mask);
+            mask &= mask - 1;
+            int slot = e + lane;
+            int node = head[slot];
+            Distance value = du + weight[slot];
+            if (value < dist[node]) {
+                dist[node] = value;
+                predEdge[node] = slot;
+                improved[count++] = node;
+            }
+        }
+    }
+    return count + relaxEdgesScalar<NodeId, Weight>(du, e, end, head, weight, minWeight, maxWeight, dist, predEdge, improved + count);
+}
+#endif
+
+RelaxKernel selectRelaxKernel() { // Pick the fastest kernel this CPU supports
+#ifdef HAVE_AVX2_KERNEL
+    if (__builtin_cpu_supports("avx2")) return relaxEdgesAVX2;
+#endif
+    return relaxEdgesScalar<NodeId, Weight>;
+}
+
+struct XorShiftRandom { // Small, fast and reproducible: the same seed gives the same numbers
+    unsigned int state;
+
+    XorShiftRandom(unsigned int seed) : state(seed ? seed : 1) {}
+
+    unsigned int next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    int below(int n) { return static_cast<int>(next() % static_cast<unsigned int>(n)); }
+    double uniform() { return next() / 4294967296.0; } // In [0, 1)
+};
+
+/* A what-if scenario on top of a pinned snapshot and the fleet, both of which
+ stay shared and untouched. The view copies the road weights only when it
+ closes its first road, and its trips are fleet vehicles by index (repeated
+ or left out to scale the demand) plus the emergency vehicles it dispatches*/
+struct ScenarioView {
+    const GraphSnapshot* base;
+    const int* snapshotNode; // Snapshot index of every intersection the fleet refers to, -1 if the snapshot lacks it
+    Weight* routeWeight;   // Own copy once a road is closed, nullptr while the base weights apply
+    int* closedEdges;      // Snapshot slots of the closed roads
+    int numClosed;
+    double demandScale;
+    int* tripVehicle;      // Fleet vehicle of each trip
+    int* tripDeparture;
+    int numTrips;
+    int tripCapacity;
+    int* dispatchFrom;     // Emergency vehicles dispatched by the scenario
+    int* dispatchTo;
+    int* dispatchDeparture;
+    int numDispatched;
+
+    ScenarioView(const GraphSnapshot* snap, const int* nodeMap, int maxClosures, int maxDispatches)
+        : base(snap), snapshotNode(nodeMap), routeWeight(nullptr), closedEdges(new int[maxClosures > 0 ? maxClosures : 1]), numClosed(0), demandScale(1.0),
+          tripVehicle(new int[16]), tripDeparture(new int[16]), numTrips(0), tripCapacity(16),
+          dispatchFrom(new int[maxDispatches > 0 ? maxDispatches : 1]), dispatchTo(new int[maxDispatches > 0 ? maxDispatches : 1]),
+          dispatchDeparture(new int[maxDispatches > 0 ? maxDispatches : 1]), numDispatched(0) {}
+
+    ~ScenarioView() {
+        delete[] routeWeight;
+        delete[] closedEdges;
+        delete[] tripVehicle;
+        delete[] tripDeparture;
+        delete[] dispatchFrom;
+        delete[] dispatchTo;
+        delete[] dispatchDeparture;
+    }
+
+    ScenarioView(const ScenarioView&) = delete;
+    ScenarioView& operator=(const ScenarioView&) = delete;
+
+    const Weight* weights() const { return routeWeight != nullptr ? routeWeight : base->routeWeight; }
+
+    void reset() { // Back to the base, keeping the allocated arrays
+        delete[] routeWeight;
+        routeWeight = nullptr;
+        numClosed = numTrips = numDispatched = 0;
+        demandScale = 1.0;
+    }
+
+    void closeRoad(int slot) {
+        if (routeWeight == nullptr) { // First change, copy the weights
+            routeWeight = new Weight[base->numEdges > 0 ? base->numEdges : 1];
+            memcpy(routeWeight, base->routeWeight, base->numEdges * sizeof(Weight));
+        }
+        routeWeight[slot] = ROUTE_BLOCKED;
+        closedEdges[numClosed++] = slot;
+    }
+
+    void addTrip(int vehicle, int departure) {
+        if (numTrips == tripCapacity) { // Double the trip arrays when full
+            int* newVehicle = new int[tripCapacity * 2];
+            int* newDeparture = new int[tripCapacity * 2];
+            for (int i = 0; i < numTrips; i++) {
+                newVehicle[i] = tripVehicle[i];
+                newDeparture[i] = tripDeparture[i];
+            }
+            delete[] tripVehicle;
+            delete[] tripDeparture;
+            tripVehicle = newVehicle;
+            tripDeparture = newDeparture;
+            tripCapacity *= 2;
+        }
+        tripVehicle[numTrips] = vehicle;
+        tripDeparture[numTrips++] = departure;
+    }
+};
+
+struct ScenarioResult {
+    unsigned int seed;
+    int numClosed;
+    double demandScale;
+    int trips;              // Trips that can be made in the base network
+    int unreachable;        // Of those, trips the closures cut off
+    int baseUnroutable;     // Trips that can't be made even without the closures
+    int stuck;              // Trips still on the road when the scenario's time ran out
+    long long totalDelay;   // Extra travel time over the base routes on empty roads, summed over the trips that arrive
+    int maxDelay;
+    int emergencyTrips;
+    long long emergencyTime; // Total travel time of the emergency vehicles that arrive
+
+    ScenarioResult() : seed(0), numClosed(0), demandScale(1.0), trips(0), unreachable(0), baseUnroutable(0), stuck(0),
+                       totalDelay(0), maxDelay(0), emergencyTrips(0), emergencyTime(0) {}
+
+    double meanDelay() const {
+        return trips - unreachable - stuck > 0 ? static_cast<double>(totalDelay) / (trips - unreachable - stuck) : 0.0;
+    }
+};
+
+/* Random road network for benchmarks: every node gets degree roads to nearby
+ node numbers with weights 1..maxWeight. Signals are left as always green.
+ The size is capped at what the profile's NodeId can number*/
+GraphSnapshot* buildSyntheticSnapshot(int numNodes, int degree, int maxWeight, unsigned int seed, bool shuffled = false) {
+    if (numNodes > MAX_NODES) numNodes = MAX_NODES;
+    GraphSnapshot* snap = new GraphSnapshot(numNodes, numNodes * degree);
+    snap->waitTable = new int[1];
+    snap->waitTable[0] = 0;
+    XorShiftRandom random(seed);
+    int* label = new int[numNodes > 0 ? numNodes : 1]; // Array position of each generated node
+    int* generated = new int[numNodes > 0 ? numNodes : 1]; // Generated node at each array position
+    for (int i = 0; i < numNodes; i++) label[i] = i;
+    if (shuffled) { // Store the nodes in random order, like a file that isn't sorted by location
+        XorShiftRandom order(seed ^ 0x5bd1e995u);
+        for (int i = numNodes - 1; i > 0; i--) swap(label[i], label[order.below(i + 1)]);
+    }
+    for (int i = 0; i < numNodes; i++) generated[label[i]] = i;
+    for (int u = 0; u < numNodes; u++) {
+        int g = generated[u];
+        snap->nodes[u] = Nodes("S" + to_string(g), 0);
+        snap->firstOut[u] = u * degree;
+        for (int k = 0; k < degree; k++) {
+            int e = u * degree + k;
+            unsigned int state = random.next();
+            int jump = static_cast<int>(state % 64) - 32; // Stay local like real roads do
+            snap->tail[e] = u;
+            snap->head[e] = label[((g + jump) % numNodes + numNodes) % numNodes];
+            snap->weight[e] = static_cast<Weight>(1 + (state >> 8) % maxWeight);
+            snap->routeWeight[e] = snap->weight[e];
+            snap->edgeId[e] = e;
+            snap->storage[e] = static_cast<unsigned short>(4 + (state >> 20) % 13); // 4 to 16 vehicles
+            snap->discharge[e] = DEFAULT_DISCHARGE_RATE;
+            snap->approachPhase[e] = 0;
+            snap->signalCycle[e] = 1;
+            snap->signalBase[e] = 0;
+        }
+    }
+    snap->firstOut[numNodes] = numNodes * degree;
+    delete[] label;
+    delete[] generated;
+    return snap;
+}
+
+/* Pins a worker thread to one CPU, so the memory it touches first is placed
+ on that CPU's NUMA node and stays close to it. Without pthreads it does nothing*/
+void pinThreadToCpu(thread& worker, int cpu) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpus);
+#else
+    (void)worker;
+    (void)cpu;
+#endif
+}
+
+struct OverlaySearch { // Per-thread work arrays of RegionOverlay::search
+    Distance* dist;
+    int* stamp;   // dist[v] is only valid where stamp[v] == current, so nothing is cleared between searches
+    int current;
+    MinHeap<Distance> heap;
+
+    OverlaySearch(int n) : dist(new Distance[n > 0 ? n : 1]), stamp(new int[n > 0 ? n : 1]), current(0), heap(64) {
+        for (int i = 0; i < n; i++) stamp[i] = 0;
+    }
+
+    ~OverlaySearch() {
+        delete[] dist;
+        delete[] stamp;
+    }
+
+    OverlaySearch(const OverlaySearch&) = delete;
+    OverlaySearch& operator=(const OverlaySearch&) = delete;
+
+    Distance get(int v) const { return stamp[v] == current ? dist[v] : ROUTE_INF; }
+};
+
+/* Multi-level overlay of a snapshot for Customizable Route Planning style queries.
+ Partitioning: the nodes are split in two by breadth-first search from a far
+ away node, again and again, and renumbered in that order, so every cell is a
+ contiguous range of node numbers and nearby roads sit nearby in memory.
+ Leaf cells are level 1, each level above joins 2^LEVEL_BITS cells of the one below.
+ Customization: for every cell, the shortest distances inside the cell between
+ its boundary nodes (nodes with a road to another cell) are stored as a clique,
+ computed from the cliques of the level below. Only customization depends on
+ the road weights, so closures just need customize() again, and a batch of
+ new travel times only updateWeights() on the cells it touches.
+ Queries: each node is expanded on the highest level whose cell holds neither
+ the source nor the target, so far away regions are crossed over cliques*/
+struct RegionOverlay {
+    static const int LEVEL_BITS = 2;
+    int numNodes;
+    int numArcs;
+    int numLevels;
+    int* oldToNew;   // Snapshot node -> overlay node
+    int* newToOld;
+    int* firstOut;   // Renumbered roads, sorted by tail
+    NodeId* head;
+    Weight* weight;  // Customized weights, ROUTE_BLOCKED for closed roads
+    int* arcSlot;    // Snapshot slot of each renumbered road
+    int* slotArc;    // Renumbered road of each snapshot slot
+    int* leaf;       // Leaf cell of each overlay node
+    int numLeaves;
+    int* numCells;   // Per level
+    int** boundaryStart; // Per level: boundary nodes of cell c are boundaryNodes[l][boundaryStart[l][c] ..]
+    int** boundaryNodes;
+    int** boundaryIndex; // Per level: position of a node in its cell's boundary list, -1 if inside
+    long long** cliqueStart; // Per level: distances of cell c start at clique[l][cliqueStart[l][c]], row-major
+    Distance** clique;
+    long long version; // Snapshot version the weights were customized for, -1 until the graph publishes it
+
+    RegionOverlay(const GraphSnapshot* snap, int leafSize, int levels) : numNodes(snap->numNodes), numArcs(snap->numEdges), numLevels(levels), version(-1) {
+        int n = numNodes;
+        oldToNew = new int[n > 0 ? n : 1];
+        newToOld = new int[n > 0 ? n : 1];
+        leaf = new int[n > 0 ? n : 1];
+        int depth = LEVEL_BITS * (numLevels - 1); // Enough bisections for every level to have cells
+        while ((n >> depth) > leafSize) depth++;
+        numLeaves = 1 << depth;
+        partition(snap, depth);
+
+        firstOut = new int[n + 1]; // Renumber the roads, keeping each node's roads together
+        head = new NodeId[numArcs > 0 ? numArcs : 1];
+        weight = new Weight[numArcs > 0 ? numArcs : 1];
+        arcSlot = new int[numArcs > 0 ? numArcs : 1];
+        slotArc = new int[numArcs > 0 ? numArcs : 1];
+        int arcs = 0;
+        for (int u = 0; u < n; u++) {
+            firstOut[u] = arcs;
+            int old = newToOld[u];
+            for (int e = snap->firstOut[old]; e < snap->firstOut[old + 1]; e++) {
+                head[arcs] = oldToNew[snap->head[e]];
+                weight[arcs] = snap->routeWeight[e];
+                slotArc[e] = arcs;
+                arcSlot[arcs++] = e;
+            }
+        }
+        firstOut[n] = arcs;
+
+        numCells = new int[numLevels + 1];
+        boundaryStart = new int*[numLevels + 1];
+        boundaryNodes = new int*[numLevels + 1];
+        boundaryIndex = new int*[numLevels + 1];
+        cliqueStart = new long long*[numLevels + 1];
+        clique = new Distance*[numLevels + 1];
+        for (int l = 1; l <= numLevels; l++) findBoundary(l);
+    }
+
+    explicit RegionOverlay(const RegionOverlay& other) : numNodes(other.numNodes), numArcs(other.numArcs), numLevels(other.numLevels), numLeaves(other.numLeaves), version(other.version) {
+        int n = numNodes > 0 ? numNodes : 1;
+        int arcs = numArcs > 0 ? numArcs : 1;
+        oldToNew = duplicate(other.oldToNew, n);
+        newToOld = duplicate(other.newToOld, n);
+        firstOut = duplicate(other.firstOut, numNodes + 1);
+        head = duplicate(other.head, arcs);
+        weight = duplicate(other.weight, arcs);
+        arcSlot = duplicate(other.arcSlot, arcs);
+        slotArc = duplicate(other.slotArc, arcs);
+        leaf = duplicate(other.leaf, n);
+        numCells = new int[numLevels + 1];
+        boundaryStart = new int*[numLevels + 1];
+        boundaryNodes = new int*[numLevels + 1];
+        boundaryIndex = new int*[numLevels + 1];
+        cliqueStart = new long long*[numLevels + 1];
+        clique = new Distance*[numLevels + 1];
+        for (int l = 1; l <= numLevels; l++) {
+            int cells = other.numCells[l];
+            int boundary = other.boundaryStart[l][cells];
+            long long distances = other.cliqueStart[l][cells];
+            numCells[l] = cells;
+            boundaryStart[l] = duplicate(other.boundaryStart[l], cells + 1);
+            boundaryNodes[l] = duplicate(other.boundaryNodes[l], boundary > 0 ? boundary : 1);
+            boundaryIndex[l] = duplicate(other.boundaryIndex[l], n);
+            cliqueStart[l] = duplicate(other.cliqueStart[l], cells + 1);
+            clique[l] = duplicate(other.clique[l], distances > 0 ? distances : 1);
+        }
+    }
+
+    template <typename T>
+    static T* duplicate(const T* from, long long count) {
+        T* copy = new T[count];
+        memcpy(copy, from, count * sizeof(T));
+        return copy;
+    }
+
+    ~RegionOverlay() {
+        delete[] oldToNew;
+        delete[] newToOld;
+        delete[] firstOut;
+        delete[] head;
+        delete[] weight;
+        delete[] arcSlot;
+        delete[] slotArc;
+        delete[] leaf;
+        for (int l = 1; l <= numLevels; l++) {
+            delete[] boundaryStart[l];
+            delete[] boundaryNodes[l];
+            delete[] boundaryIndex[l];
+            delete[] cliqueStart[l];
+            delete[] clique[l];
+        }
+        delete[] numCells;
+        delete[] boundaryStart;
+        delete[] boundaryNodes;
+        delete[] boundaryIndex;
+        delete[] cliqueStart;
+        delete[] clique;
+    }
+
+    /* Deep copy with the same partition and cliques, so new weights can be
+     customized into it while readers keep querying the original*/
+    RegionOverlay* clone() const {
+        return new RegionOverlay(*this);
+    }
+
+    RegionOverlay& operator=(const RegionOverlay&) = delete;
+
+    bool sameRoads(const GraphSnapshot* snap) const { // Same nodes and roads, weights aside
+        if (snap->numNodes != numNodes || snap->numEdges != numArcs) return false;
+        for (int u = 0; u < numNodes; u++) {
+            for (int a = firstOut[u]; a < firstOut[u + 1]; a++) {
+                int e = arcSlot[a];
+                if (snap->tail[e] != newToOld[u] || snap->head[e] != newToOld[head[a]]) return false;
+            }
+        }
+        return true;
+    }
+
+    int cellOf(int level, int v) const { return leaf[v] >> (LEVEL_BITS * (level - 1)); }
+
+    /* Recursive bisection over the roads taken in both directions. A range of
+     the order array is one cell; breadth-first search from a node far from the
+     others lists the range in growing distance and the first half becomes
+     the left cell. Unconnected parts are appended in the same way*/
+    void partition(const GraphSnapshot* snap, int depth) {
+        int n = numNodes;
+        int* adjStart = new int[n + 1]; // Roads in both directions
+        int* adj = new int[2 * numArcs > 0 ? 2 * numArcs : 1];
+        for (int u = 0; u <= n; u++) adjStart[u] = 0;
+        for (int e = 0; e < numArcs; e++) {
+            adjStart[snap->tail[e] + 1]++;
+            adjStart[snap->head[e] + 1]++;
+        }
+        for (int u = 0; u < n; u++) adjStart[u + 1] += adjStart[u];
+        int* fill = new int[n > 0 ? n : 1];
+        for (int u = 0; u < n; u++) fill[u] = adjStart[u];
+        for (int e = 0; e < numArcs; e++) {
+            adj[fill[snap->tail[e]]++] = snap->head[e];
+            adj[fill[snap->head[e]]++] = snap->tail[e];
+        }
+
+        int* order = newToOld; // Built in place: the final order is the renumbering
+        for (int u = 0; u < n; u++) order[u] = u;
+        int* rangeOf = fill;   // Range token of each node, marks who is inside the range being split
+        for (int u = 0; u < n; u++) rangeOf[u] = 0;
+        int* queue = new int[n > 0 ? n : 1];
+        int* seen = new int[n > 0 ? n : 1];
+        for (int u = 0; u < n; u++) seen[u] = 0;
+        int searchId = 0;
+        int nextToken = 1;
+
+        /* Explicit stack of ranges instead of recursion: (begin, end, level, leaf prefix)*/
+        int stackSize = 2 * depth + 2;
+        int* stackBegin = new int[stackSize];
+        int* stackEnd = new int[stackSize];
+        int* stackDepth = new int[stackSize];
+        int* stackPrefix = new int[stackSize];
+        stackBegin[0] = 0;
+        stackEnd[0] = n;
+        stackDepth[0] = 0;
+        stackPrefix[0] = 0;
+        int top = 1;
+        while (top > 0) {
+            top--;
+            int begin = stackBegin[top], end = stackEnd[top], level = stackDepth[top], prefix = stackPrefix[top];
+            if (level == depth) { // A leaf cell
+                for (int i = begin; i < end; i++) leaf[i] = prefix;
+                continue;
+            }
+            int token = nextToken++;
+            for (int i = begin; i < end; i++) rangeOf[order[i]] = token;
+
+            if (end - begin > 1) { // Breadth-first order of the range, twice: the second search starts where the first ended
+                int count = 0;
+                for (int pass = 0; pass < 2; pass++) {
+                    int root = pass == 0 ? order[begin] : queue[count - 1];
+                    searchId++;
+                    count = 0;
+                    int next = begin; // Scans the range for unconnected parts
+                    while (root != -1) {
+                        int qHead = count;
+                        seen[root] = searchId;
+                        queue[count++] = root;
+                        while (qHead < count) {
+                            int u = queue[qHead++];
+                            for (int a = adjStart[u]; a < adjStart[u + 1]; a++) {
+                                int v = adj[a];
+                                if (rangeOf[v] == token && seen[v] != searchId) {
+                                    seen[v] = searchId;
+                                    queue[count++] = v;
+                                }
+                            }
+                        }
+                        while (next < end && seen[order[next]] == searchId) next++;
+                        root = next < end ? order[next] : -1;
+                    }
+                }
+                for (int i = 0; i < end - begin; i++) order[begin + i] = queue[i];
+            }
+
+            int middle = begin + (end - begin) / 2;
+            stackBegin[top] = middle; // Right half on the stack first so the left one is numbered first
+            stackEnd[top] = end;
+            stackDepth[top] = level + 1;
+            stackPrefix[top++] = prefix * 2 + 1;
+            stackBegin[top] = begin;
+            stackEnd[top] = middle;
+            stackDepth[top] = level + 1;
+            stackPrefix[top++] = prefix * 2;
+        }
+        for (int i = 0; i < n; i++) oldToNew[order[i]] = i;
+
+        delete[] adjStart;
+        delete[] adj;
+        delete[] fill;
+        delete[] queue;
+        delete[] seen;
+        delete[] stackBegin;
+        delete[] stackEnd;
+        delete[] stackDepth;
+        delete[] stackPrefix;
+    }
+
+    void findBoundary(int l) { // Boundary nodes of every level l cell and room for their cliques
+        int n = numNodes;
+        numCells[l] = ((numLeaves - 1) >> (LEVEL_BITS * (l - 1))) + 1;
+        boundaryIndex[l] = new int[n > 0 ? n : 1];
+        for (int u = 0; u < n; u++) boundaryIndex[l][u] = -1;
+        for (int u = 0; u < n; u++) {
+            for (int a = firstOut[u]; a < firstOut[u + 1]; a++) {
+                if (cellOf(l, u) != cellOf(l, head[a])) { // A road between cells makes both ends boundary nodes
+                    boundaryIndex[l][u] = 0;
+                    boundaryIndex[l][head[a]] = 0;
+                }
+            }
+        }
+        boundaryStart[l] = new int[numCells[l] + 1];
+        for (int c = 0; c <= numCells[l]; c++) boundaryStart[l][c] = 0;
+        for (int u = 0; u < n; u++) {
+            if (boundaryIndex[l][u] == 0) boundaryStart[l][cellOf(l, u) + 1]++;
+        }
+        for (int c = 0; c < numCells[l]; c++) boundaryStart[l][c + 1] += boundaryStart[l][c];
+        boundaryNodes[l] = new int[boundaryStart[l][numCells[l]] > 0 ? boundaryStart[l][numCells[l]] : 1];
+        cliqueStart[l] = new long long[numCells[l] + 1];
+        cliqueStart[l][0] = 0;
+        for (int c = 0; c < numCells[l]; c++) {
+            long long size = boundaryStart[l][c + 1] - boundaryStart[l][c];
+            cliqueStart[l][c + 1] = cliqueStart[l][c] + size * size;
+        }
+        int* fill = new int[numCells[l] > 0 ? numCells[l] : 1];
+        for (int c = 0; c < numCells[l]; c++) fill[c] = 0;
+        for (int u = 0; u < n; u++) { // Nodes are numbered by cell, so each list comes out sorted
+            if (boundaryIndex[l][u] == -1) continue;
+            int c = cellOf(l, u);
+            boundaryIndex[l][u] = fill[c]++;
+            boundaryNodes[l][boundaryStart[l][c] + boundaryIndex[l][u]] = u;
+        }
+        delete[] fill;
+        clique[l] = new Distance[cliqueStart[l][numCells[l]] > 0 ? cliqueStart[l][numCells[l]] : 1]; // Filled by customize
+    }
+
+    /* Dijkstra over the overlay. A node is expanded on the highest level (up to
+     maxLevel) whose cell holds neither src nor target (-1 for no target): there
+     it follows its cell's clique and the roads that leave the cell, on level 0
+     all its roads. With restrictLevel set the search stays in src's cell of
+     that level. Stops once target is settled*/
+    void search(int src, int target, int maxLevel, int restrictLevel, OverlaySearch& s) const {
+        s.current++;
+        s.heap.clear();
+        s.stamp[src] = s.current;
+        s.dist[src] = 0;
+        s.heap.push(0, src);
+        int restrictCell = restrictLevel > 0 ? cellOf(restrictLevel, src) : -1;
+        while (!s.heap.empty()) {
+            Distance d;
+            int u;
+            s.heap.pop(d, u);
+            if (d > s.dist[u]) continue; // Stale heap entry
+            if (u == target) break;
+            int level = 0;
+            for (int k = maxLevel; k >= 1; k--) {
+                int cell = cellOf(k, u);
+                if (cell != cellOf(k, src) && (target == -1 || cell != cellOf(k, target))) {
+                    level = k;
+                    break;
+                }
+            }
+            if (level > 0 && boundaryIndex[level][u] == -1) level = 0; // Not entered over the boundary, can't take the clique
+            if (level > 0) { // Cross the cell over its clique
+                int cell = cellOf(level, u);
+                int first = boundaryStart[level][cell];
+                int size = boundaryStart[level][cell + 1] - first;
+                const Distance* row = clique[level] + cliqueStart[level][cell] + static_cast<long long>(boundaryIndex[level][u]) * size;
+                for (int j = 0; j < size; j++) {
+                    if (row[j] < ROUTE_INF - d) relaxTo(s, boundaryNodes[level][first + j], d + row[j]); // Reachable, and the sum can't overflow
+                }
+            }
+            for (int a = firstOut[u]; a < firstOut[u + 1]; a++) {
+                Weight w = weight[a];
+                int v = head[a];
+                if (w > ROUTE_MAX_WEIGHT) continue; // Closed road
+                if (level > 0 && cellOf(level, v) == cellOf(level, u)) continue; // Covered by the clique
+                if (restrictCell != -1 && cellOf(restrictLevel, v) != restrictCell) continue;
+                relaxTo(s, v, d + w);
+            }
+        }
+    }
+
+    /* Dijkstra on the overlay of level l - 1 inside src's level l cell: only
+     boundary nodes of level l - 1 are visited, crossing each cell over its
+     clique and going between cells over the roads that join them. src must
+     be a boundary node of level l, which makes it one of every level below*/
+    void cliqueSearch(int src, int l, OverlaySearch& s) const {
+        int k = l - 1;
+        int restrictCell = cellOf(l, src);
+        s.current++;
+        s.heap.clear();
+        s.stamp[src] = s.current;
+        s.dist[src] = 0;
+        s.heap.push(0, src);
+        while (!s.heap.empty()) {
+            Distance d;
+            int u;
+            s.heap.pop(d, u);
+            if (d > s.dist[u]) continue; // Stale heap entry
+            int cell = cellOf(k, u);
+            int first = boundaryStart[k][cell];
+            int size = boundaryStart[k][cell + 1] - first;
+            const Distance* row = clique[k] + cliqueStart[k][cell] + static_cast<long long>(boundaryIndex[k][u]) * size;
+            for (int j = 0; j < size; j++) {
+                if (row[j] < ROUTE_INF - d) relaxTo(s, boundaryNodes[k][first + j], d + row[j]);
+            }
+            for (int a = firstOut[u]; a < firstOut[u + 1]; a++) {
+                int v = head[a];
+                if (weight[a] > ROUTE_MAX_WEIGHT || cellOf(k, v) == cell || cellOf(l, v) != restrictCell) continue;
+                relaxTo(s, v, d + weight[a]);
+            }
+        }
+    }
+
+    void relaxTo(OverlaySearch& s, int v, Distance d) const {
+        if (s.stamp[v] != s.current) {
+            s.stamp[v] = s.current;
+            s.dist[v] = ROUTE_INF;
+        }
+        if (d < s.dist[v]) {
+            s.dist[v] = d;
+            s.heap.push(d, v);
+        }
+    }
+
+    /* Recomputes the cliques of the given level l cells (all of them for
+     cells == nullptr) from the level below. Each worker owns a contiguous
+     region of the list and is pinned to its own CPU, so the cliques it
+     writes first land in that CPU's memory. With changed given, changed[k]
+     tells if the clique of the k-th cell came out different*/
+    void customizeLevel(int l, const int* cells, int count, int numThreads, bool* changed = nullptr) {
+        if (cells == nullptr) count = numCells[l];
+        if (numThreads < 1) numThreads = 1;
+        int workers = numThreads < count ? numThreads : count;
+        int cpus = static_cast<int>(thread::hardware_concurrency());
+        auto region = [&](int w) {
+            OverlaySearch s(numNodes);
+            for (int k = count * w / workers; k < count * (w + 1) / workers; k++) {
+                int c = cells == nullptr ? k : cells[k];
+                int first = boundaryStart[l][c];
+                int size = boundaryStart[l][c + 1] - first;
+                Distance* cellClique = clique[l] + cliqueStart[l][c];
+                bool differs = false;
+                for (int i = 0; i < size; i++) {
+                    if (l == 1) search(boundaryNodes[l][first + i], -1, 0, 1, s); // Plain Dijkstra inside the leaf
+                    else cliqueSearch(boundaryNodes[l][first + i], l, s); // Over the cliques of the level below
+                    for (int j = 0; j < size; j++) {
+                        Distance d = s.get(boundaryNodes[l][first + j]);
+                        if (cellClique[i * size + j] != d) {
+                            cellClique[i * size + j] = d;
+                            differs = true;
+                        }
+                    }
+                }
+                if (changed != nullptr) changed[k] = differs;
+            }
+        };
+        thread* pool = new thread[workers > 1 ? workers - 1 : 1];
+        for (int w = 1; w < workers; w++) {
+            pool[w - 1] = thread(region, w);
+            if (cpus > 1) pinThreadToCpu(pool[w - 1], static_cast<int>(static_cast<long long>(w) * cpus / workers));
+        }
+        if (workers > 0) region(0);
+        for (int w = 1; w < workers; w++) pool[w - 1].join();
+        delete[] pool;
+    }
+
+    void customize(const Weight* routeWeight, int numThreads) { // All weights of the snapshot slots, every clique
+        for (int a = 0; a < numArcs; a++) weight[a] = routeWeight[arcSlot[a]];
+        for (int l = 1; l <= numLevels; l++) customizeLevel(l, nullptr, 0, numThreads);
+    }
+
+    /* Takes new weights for a batch of snapshot slots and recomputes only the
+     cells they affect. A road counts for the lowest level cell holding both
+     its ends; a cell of the level above is redone only when one of its parts
+     came out different, so changes off every shortest path stop early.
+     Returns the number of cells redone*/
+    int updateWeights(const Weight* routeWeight, const int* slots, int count, int numThreads) {
+        bool** dirty = new bool*[numLevels + 1];
+        for (int l = 1; l <= numLevels; l++) {
+            dirty[l] = new bool[numCells[l]];
+            for (int c = 0; c < numCells[l]; c++) dirty[l][c] = false;
+        }
+        for (int k = 0; k < count; k++) {
+            int a = slotArc[slots[k]];
+            if (weight[a] == routeWeight[slots[k]]) continue;
+            weight[a] = routeWeight[slots[k]];
+            int u = static_cast<int>(upper_bound(firstOut, firstOut + numNodes + 1, a) - firstOut) - 1; // Tail of the road
+            for (int l = 1; l <= numLevels; l++) {
+                if (cellOf(l, u) == cellOf(l, head[a])) {
+                    dirty[l][cellOf(l, u)] = true;
+                    break;
+                }
+            }
+        }
+        int redone = 0;
+        int* cells = new int[numCells[1] > 0 ? numCells[1] : 1];
+        bool* changed = new bool[numCells[1] > 0 ? numCells[1] : 1];
+        for (int l = 1; l <= numLevels; l++) { // Bottom up, every level uses the one below
+            int numDirty = 0;
+            for (int c = 0; c < numCells[l]; c++) {
+                if (dirty[l][c]) cells[numDirty++] = c;
+            }
+            if (numDirty > 0) customizeLevel(l, cells, numDirty, numThreads, changed);
+            for (int k = 0; k < numDirty && l < numLevels; k++) {
+                if (changed[k]) dirty[l + 1][cells[k] >> LEVEL_BITS] = true;
+            }
+            redone += numDirty;
+            delete[] dirty[l];
+        }
+        delete[] dirty;
+        delete[] cells;
+        delete[] changed;
+        return redone;
+    }
+
+    Distance query(int fromOld, int toOld, OverlaySearch& s) const { // Shortest distance between two snapshot nodes
+        int from = oldToNew[fromOld], to = oldToNew[toOld];
+        search(from, to, numLevels, 0, s);
+        return s.get(to);
+    }
+
+    long long cliqueEntries() const {
+        long long total = 0;
+        for (int l = 1; l <= numLevels; l++) total += cliqueStart[l][numCells[l]];
+        return total;
+    }
+};
+
+const int ROUTE_CACHE_ENTRIES = 65536; // Routes the cache holds over all its shards
+const int ROUTE_CACHE_SHARDS = 16; // Each with its own lock, so concurrent routers rarely wait
+const long long ROUTE_CACHE_MAX_BYTES = 64LL << 20; // Bound on the road slots of the cached routes
+const int ROUTE_CACHE_STATIC = -1; // Time bucket of routes that don't depend on the departure time
+const int ROUTE_CACHE_TIME_BUCKET = 60; // Seconds of departure time that share a time dependent route
+
+struct RouteCacheEntry {
+    int from;        // -1 while the entry is free
+    int to;
+    int timeBucket;
+    long long version; // Snapshot the route was found on
+    long long cost;    // Distance or travel time, -1 when there is no route
+    Route route;
+    int next;        // Next entry in the same hash chain or the free list, -1 at the end
+    bool referenced; // Hit since the clock hand last passed
+
+    RouteCacheEntry() : from(-1), to(-1), timeBucket(0), version(-1), cost(-1), next(-1), referenced(false) {}
+};
+
+struct RouteCacheShard {
+    mutex lock;
+    RouteCacheEntry* entries;
+    int* chainHead; // First entry of every hash chain, -1 when empty
+    int freeHead;   // First free entry
+    int hand;       // Clock hand, the next eviction candidate
+    int used;
+    long long routeBytes; // Road slots held by the cached routes
+    long long hits, misses, stale, evictions;
+
+    RouteCacheShard() : entries(nullptr), chainHead(nullptr), freeHead(-1), hand(0), used(0), routeBytes(0), hits(0), misses(0), stale(0), evictions(0) {}
+
+    ~RouteCacheShard() {
+        delete[] entries;
+        delete[] chainHead;
+    }
+
+    RouteCacheShard(const RouteCacheShard&) = delete;
+    RouteCacheShard& operator=(const RouteCacheShard&) = delete;
+};
+
+/* Bounded cache of routes keyed by (origin, destination, departure time bucket).
+ Every entry carries the snapshot version it was found on, and a lookup only
+ hits on the same version: an edit publishes a new version, so old entries stop
+ answering without a flush and are freed when next looked up or passed by the
+ clock. Keys hash to one of the shards; a shard chains its entries and evicts
+ with the clock algorithm, giving entries that were hit since the hand last
+ passed a second chance and taking entries of older versions first*/
+struct RouteCache {
+    RouteCacheShard* shards;
+    int numShards;
+    int shardCapacity;
+    int chainMask;
+    long long shardByteLimit;
+
+    RouteCache(int capacity, int shardCount) : shards(new RouteCacheShard[shardCount]), numShards(shardCount),
+                                               shardCapacity(max(1, capacity / shardCount)), chainMask(1), shardByteLimit(ROUTE_CACHE_MAX_BYTES / shardCount) {
+        while (chainMask < shardCapacity) chainMask <<= 1; // Load factor at most 1
+        chainMask--;
+        for (int s = 0; s < numShards; s++) {
+            RouteCacheShard& shard = shards[s];
+            shard.entries = new RouteCacheEntry[shardCapacity];
+            shard.chainHead = new int[chainMask + 1];
+            for (int c = 0; c <= chainMask; c++) shard.chainHead[c] = -1;
+            for (int i = 0; i < shardCapacity; i++) shard.entries[i].next = i + 1 < shardCapacity ? i + 1 : -1;
+            shard.freeHead = 0;
+        }
+    }
+
+    ~RouteCache() {
+        delete[] shards;
+    }
+
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+    static unsigned int hashKey(int from, int to, int timeBucket) {
+        unsigned long long h = static_cast<unsigned int>(from) * 0x9e3779b97f4a7c15ULL;
+        h ^= (static_cast<unsigned long long>(static_cast<unsigned int>(to)) << 32 | static_cast<unsigned int>(timeBucket)) * 0xc2b2ae3d27d4eb4fULL;
+        h ^= h >> 31;
+        return static_cast<unsigned int>(h ^ (h >> 32));
+    }
+
+    static long long bytesOf(const Route& route) { return static_cast<long long>(route.length) * sizeof(int); }
+
+    int chainOf(unsigned int hash) const { return static_cast<int>((hash / numShards) & chainMask); }
+
+    void release(RouteCacheShard& shard, int at) { // Unlinks entry at from its chain and frees it, the shard is locked
+        RouteCacheEntry& entry = shard.entries[at];
+        int* link = &shard.chainHead[chainOf(hashKey(entry.from, entry.to, entry.timeBucket))];
+        while (*link != at) link = &shard.entries[*link].next;
+        *link = entry.next;
+        shard.routeBytes -= bytesOf(entry.route);
+        entry.route = Route();
+        entry.from = -1;
+        entry.next = shard.freeHead;
+        shard.freeHead = at;
+        shard.used--;
+    }
+
+    void evictOne(RouteCacheShard& shard, long long version) { // The shard is locked and not empty
+        while (true) {
+            int at = shard.hand;
+            shard.hand = shard.hand + 1 < shardCapacity ? shard.hand + 1 : 0;
+            RouteCacheEntry& entry = shard.entries[at];
+            if (entry.from == -1) continue;
+            if (entry.referenced && entry.version >= version) { // Second chance
+                entry.referenced = false;
+                continue;
+            }
+            release(shard, at);
+            shard.evictions++;
+            return;
+        }
+    }
+
+    /* Copies the cached route and its cost when an entry for the key was found on
+     snapshot version. An entry of an older version is freed on the way*/
+    bool lookup(int from, int to, int timeBucket, long long version, Route& route, long long& cost) {
+        unsigned int hash = hashKey(from, to, timeBucket);
+        RouteCacheShard& shard = shards[hash % numShards];
+        lock_guard<mutex> lock(shard.lock);
+        for (int at = shard.chainHead[chainOf(hash)]; at != -1; at = shard.entries[at].next) {
+            RouteCacheEntry& entry = shard.entries[at];
+            if (entry.from != from || entry.to != to || entry.timeBucket != timeBucket) continue;
+            if (entry.version == version) {
+                entry.referenced = true;
+                route = entry.route.clone();
+                cost = entry.cost;
+                shard.hits++;
+                return true;
+            }
+            if (entry.version < version) { // The roads changed since, the entry can't answer again
+                release(shard, at);
+                shard.stale++;
+            }
+            break;
+        }
+        shard.misses++;
+        return false;
+    }
+
+    void insert(int from, int to, int timeBucket, long long version, const Route& route, long long cost) {
+        long long bytes = bytesOf(route);
+        unsigned int hash = hashKey(from, to, timeBucket);
+        RouteCacheShard& shard = shards[hash % numShards];
+        if (bytes > shardByteLimit) return; // Would push every other route of the shard out
+        lock_guard<mutex> lock(shard.lock);
+        int chain = chainOf(hash);
+        for (int at = shard.chainHead[chain]; at != -1; at = shard.entries[at].next) {
+            RouteCacheEntry& entry = shard.entries[at];
+            if (entry.from != from || entry.to != to || entry.timeBucket != timeBucket) continue;
+            if (entry.version >= version) return; // Another router stored it first, or a newer version is held
+            release(shard, at);
+            break;
+        }
+        while (shard.used > 0 && (shard.used == shardCapacity || shard.routeBytes + bytes > shardByteLimit)) evictOne(shard, version);
+
+        int at = shard.freeHead;
+        RouteCacheEntry& entry = shard.entries[at];
+        shard.freeHead = entry.next;
+        entry.from = from;
+        entry.to = to;
+        entry.timeBucket = timeBucket;
+        entry.version = version;
+        entry.cost = cost;
+        entry.route = route.clone();
+        entry.referenced = false;
+        entry.next = shard.chainHead[chain];
+        shard.chainHead[chain] = at;
+        shard.routeBytes += bytes;
+        shard.used++;
+    }
+
+    /* Counters summed over the shards. bytes is the memory the cache holds:
+     its fixed entry and chain arrays plus the road slots of the cached routes*/
+    void summary(long long& hits, long long& misses, long long& stale, long long& evictions, int& entries, long long& bytes) {
+        hits = misses = stale = evictions = bytes = 0;
+        entries = 0;
+        for (int s = 0; s < numShards; s++) {
+            lock_guard<mutex> lock(shards[s].lock);
+            hits += shards[s].hits;
+            misses += shards[s].misses;
+            stale += shards[s].stale;
+            evictions += shards[s].evictions;
+            entries += shards[s].used;
+            bytes += shards[s].routeBytes;
+        }
+        bytes += static_cast<long long>(numShards) * (static_cast<long long>(shardCapacity) * sizeof(RouteCacheEntry) + (chainMask + 1) * sizeof(int));
+    }
+
+    int capacity() const { return numShards * shardCapacity; }
+};
+
+class Graph {
+private:
+    Nodes* intersections; // Array of intersections
+    Edges* streets; // Array of roads, for example if from has A and To has D than the street will be from A to D
+    int numNodes; // Current number of intersections
+    int numEdges; // Current number of roads
+    int nodeCapacity; // Maximum number of intersections
+    int edgeCapacity; // Maximum number of roads
+    int* vehicleCounts; // Number of vehicles per road
+    int hashTableSize; // Size of the hash table
+
+    /* Snapshot publishing with epoch based reclamation. A reader stores the
+     current epoch in a free slot before loading the snapshot pointer; a
+     replaced snapshot is freed once every pinned reader has a newer epoch*/
+    static const int MAX_READERS = 64;
+    atomic<GraphSnapshot*> currentSnapshot; // Latest published version
+    atomic<unsigned long long> globalEpoch;
+    atomic<unsigned long long> readerEpochs[MAX_READERS]; // 0 means the slot is free
+    GraphSnapshot** retiredSnapshots; // Replaced versions still waiting for readers
+    RegionOverlay** retiredOverlays;  // Replaced overlays, retired the same way (either may be null)
+    unsigned long long* retiredEpochs;
+    int numRetired;
+    int retiredCapacity;
+    atomic<long long> graphVersion; // Bumped on every published edit
+    int deferredPublishes; // Batch edits publish once at the end
+    recursive_mutex writerMutex; // Writers take turns, readers never lock
+    RelaxKernel relaxKernel; // Scalar or AVX2, picked once for this CPU
+    atomic<RegionOverlay*> overlay; // Published like the snapshots: customized for overlay->version, then never changed
+    RouteCache routeCache; // Routes of repeated queries, keyed on the snapshot version
+    bool reportEdits; // Print a line for every node and road added, batch runs turn it off
+
+    void resizeNodes() {   // increasing capacity of intersection
+        nodeCapacity *= 2; 
+        Nodes* temp = new Nodes[nodeCapacity]; // Create a new larger array
+        for (int i = 0; i < numNodes; i++) temp[i] = intersections[i]; 
+        delete[] intersections; // Free old memory
+        intersections = temp; // Update to new array
+    }
+
+    void resizeEdges() { // Increase capacity of roads array
+        edgeCapacity *= 2; 
+        Edges* temp = new Edges[edgeCapacity]; 
+        for (int i = 0; i < numEdges; i++) temp[i] = streets[i];
+        delete[] streets;
+        streets = temp; 
+    }
+
+    int hashFunction(const string& fromName, const string& toName) {
+        /* Simple hash function using the
+         sum of ASCII values of the names*/
+        int hash = 0;
+        for (char c : fromName) hash += c;
+        for (char c : toName) hash += c;
+        return hash % hashTableSize;
+    }
+
+    GraphSnapshot* buildSnapshot() { // Copy the live arrays into a new CSR snapshot
+        GraphSnapshot* snap = new GraphSnapshot(numNodes, numEdges);
+        for (int i = 0; i < numNodes; i++) snap->nodes[i] = intersections[i];
+
+        /* Every phase of a signal gets a table with the wait for each arrival
+         second of the cycle, so a lookup is one modulo and one load*/
+        int* tableStart = new int[numNodes > 0 ? numNodes : 1];
+        int tableSize = 0;
+        for (int i = 0; i < numNodes; i++) {
+            tableStart[i] = tableSize;
+            tableSize += intersections[i].numPhases * intersections[i].cycle;
+        }
+        snap->waitTable = new int[tableSize > 0 ? tableSize : 1];
+        for (int i = 0; i < numNodes; i++) {
+            const Nodes& node = intersections[i];
+            fillSignalWaitTable(snap->waitTable + tableStart[i], node.cycle, node.offset, node.phaseGreen, node.numPhases);
+        }
+
+        for (int i = 0; i <= numNodes; i++) snap->firstOut[i] = 0;
+        for (int i = 0; i < numEdges; i++) snap->firstOut[streets[i].from + 1]++; // Count out-edges per node
+        for (int i = 0; i < numNodes; i++) snap->firstOut[i + 1] += snap->firstOut[i]; // Turn counts into start offsets
+
+        int* fill = new int[numNodes > 0 ? numNodes : 1];
+        int* incoming = new int[numNodes > 0 ? numNodes : 1]; // Roads seen so far into each node
+        for (int i = 0; i < numNodes; i++) {
+            fill[i] = snap->firstOut[i];
+            incoming[i] = 0;
+        }
+        for (int i = 0; i < numEdges; i++) { // Place every road in its from node's slot range
+            int slot = fill[streets[i].from]++;
+            int to = streets[i].to;
+            snap->tail[slot] = streets[i].from;
+            snap->head[slot] = to;
+            snap->weight[slot] = streets[i].weight;
+            snap->routeWeight[slot] = streets[i].isActive ? streets[i].weight : ROUTE_BLOCKED;
+            snap->edgeId[slot] = i;
+            snap->storage[slot] = streets[i].capacity > 0 ? streets[i].capacity : 1;
+            snap->discharge[slot] = streets[i].discharge > 0 ? streets[i].discharge : 1;
+            snap->approachPhase[slot] = static_cast<unsigned char>(incoming[to]++ % intersections[to].numPhases); // Incoming roads take turns over the phases
+            snap->signalCycle[slot] = intersections[to].cycle;
+            snap->signalBase[slot] = tableStart[to] + snap->approachPhase[slot] * intersections[to].cycle;
+        }
+        delete[] fill;
+        delete[] incoming;
+        delete[] tableStart;
+        return snap;
+    }
+
+    void reclaimSnapshots() { // Free retired snapshots that no reader can still hold
+        int kept = 0;
+        for (int r = 0; r < numRetired; r++) {
+            bool inUse = false;
+            for (int s = 0; s < MAX_READERS && !inUse; s++) {
+                unsigned long long pinned = readerEpochs[s].load();
+                inUse = pinned != 0 && pinned <= retiredEpochs[r];
+            }
+            if (inUse) {
+                retiredSnapshots[kept] = retiredSnapshots[r];
+                retiredOverlays[kept] = retiredOverlays[r];
+                retiredEpochs[kept] = retiredEpochs[r];
+                kept++;
+            } else {
+                delete retiredSnapshots[r];
+                delete retiredOverlays[r];
+            }
+        }
+        numRetired = kept;
+    }
+
+    void publishSnapshot() { // Called by writers after every edit
+        lock_guard<recursive_mutex> lock(writerMutex);
+        if (deferredPublishes > 0) return; // endBatchEdit will publish
+
+        GraphSnapshot* snap = buildSnapshot();
+        snap->version = ++graphVersion;
+        retire(currentSnapshot.exchange(snap), nullptr);
+    }
+
+    /* Replaces the published overlay; readers that loaded the old one keep it
+     until they unpin. Callers hold writerMutex*/
+    void publishOverlay(RegionOverlay* regions) {
+        RegionOverlay* old = overlay.exchange(regions);
+        if (old != nullptr) retire(nullptr, old);
+    }
+
+    void retire(GraphSnapshot* oldSnapshot, RegionOverlay* oldOverlay) { // Called right after the exchange, under writerMutex
+        unsigned long long retireEpoch = globalEpoch.fetch_add(1); // Readers pinned after this see the new version
+
+        if (numRetired == retiredCapacity) { // Grow the retired list
+            retiredCapacity *= 2;
+            GraphSnapshot** newSnapshots = new GraphSnapshot*[retiredCapacity];
+            RegionOverlay** newOverlays = new RegionOverlay*[retiredCapacity];
+            unsigned long long* newEpochs = new unsigned long long[retiredCapacity];
+            for (int i = 0; i < numRetired; i++) {
+                newSnapshots[i] = retiredSnapshots[i];
+                newOverlays[i] = retiredOverlays[i];
+                newEpochs[i] = retiredEpochs[i];
+            }
+            delete[] retiredSnapshots;
+            delete[] retiredOverlays;
+            delete[] retiredEpochs;
+            retiredSnapshots = newSnapshots;
+            retiredOverlays = newOverlays;
+            retiredEpochs = newEpochs;
+        }
+        retiredSnapshots[numRetired] = oldSnapshot;
+        retiredOverlays[numRetired] = oldOverlay;
+        retiredEpochs[numRetired] = retireEpoch;
+        numRetired++;
+        reclaimSnapshots();
+    }
+
+public:
+    Graph() : intersections(nullptr), streets(nullptr), numNodes(0), numEdges(0), nodeCapacity(10), edgeCapacity(10), vehicleCounts(nullptr), hashTableSize(100),
+              currentSnapshot(nullptr), globalEpoch(1), retiredSnapshots(nullptr), retiredOverlays(nullptr), retiredEpochs(nullptr), numRetired(0), retiredCapacity(8), graphVersion(0), deferredPublishes(0), relaxKernel(selectRelaxKernel()),
+              overlay(nullptr), routeCache(ROUTE_CACHE_ENTRIES, ROUTE_CACHE_SHARDS), reportEdits(true) {
+        intersections = new Nodes[nodeCapacity]; // Initialize intersections with initial capacity of 10
+        streets = new Edges[edgeCapacity]; // Initialize roads....
+        vehicleCounts = new int[hashTableSize]; // Initialize vehicle counts...
+        for (int i = 0; i < hashTableSize; i++) vehicleCounts[i] = 0; // Initialize all counts to 0
+        for (int i = 0; i < MAX_READERS; i++) readerEpochs[i] = 0; // All reader slots start free
+        retiredSnapshots = new GraphSnapshot*[retiredCapacity];
+        retiredOverlays = new RegionOverlay*[retiredCapacity];
+        retiredEpochs = new unsigned long long[retiredCapacity];
+        currentSnapshot = buildSnapshot(); // Empty version 0 so readers always find one
+    }
+
+    virtual ~Graph() { // For memory release
+        delete[] intersections; // Free intersections array
+        delete[] streets; // Free roads array
+        delete[] vehicleCounts; // Free vehicle counts
+        for (int i = 0; i < numRetired; i++) { // No readers are left at this point
+            delete retiredSnapshots[i];
+            delete retiredOverlays[i];
+        }
+        delete[] retiredSnapshots;
+        delete[] retiredOverlays;
+        delete[] retiredEpochs;
+        delete currentSnapshot.load();
+        delete overlay.load();
+    }
+
+    /* Pin the current snapshot for a query. The snapshot stays valid
+     until unpinSnapshot is called with the returned reader slot*/
+    int pinSnapshot(const GraphSnapshot*& snapshot) {
+        while (true) {
+            for (int s = 0; s < MAX_READERS; s++) {
+                unsigned long long expected = 0;
+                if (readerEpochs[s].compare_exchange_strong(expected, globalEpoch.load())) {
+                    snapshot = currentSnapshot.load();
+                    return s;
+                }
+            }
+            this_thread::yield(); // Every slot is busy, wait for a reader to finish
+        }
+    }
+
+    void unpinSnapshot(int readerSlot) {
+        readerEpochs[readerSlot].store(0);
+    }
+
+    void beginBatchEdit() { // Group many edits (e.g. file loading) into one published version
+        lock_guard<recursive_mutex> lock(writerMutex);
+        deferredPublishes++;
+    }
+
+    void endBatchEdit() {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        deferredPublishes--;
+        publishSnapshot();
+    }
+
+    long long getGraphVersion() {
+        return graphVersion.load(); // Version readers currently get
+    }
+
+    int snapshotNodeIndex(const GraphSnapshot* snap, const string& name) {
+        for (int i = 0; i < snap->numNodes; i++) {  // Searching the pinned copy of the nodes
+            if (snap->nodes[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* Snapshot index of every intersection, matched by name, -1 where the
+     snapshot doesn't have it. The numberings only differ when intersections
+     were deleted or added after snap was published, so a name is only
+     searched for when the same index holds another one*/
+    int* snapshotNodeMap(const GraphSnapshot* snap) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        int* map = new int[numNodes > 0 ? numNodes : 1];
+        for (int i = 0; i < numNodes; i++) {
+            bool same = i < snap->numNodes && snap->nodes[i].name == intersections[i].name;
+            map[i] = same ? i : snapshotNodeIndex(snap, intersections[i].name);
+        }
+        return map;
+    }
+     int getnumEdges() {
+    return numEdges;  // Just returning the number of edges here.
+    }
+
+    int getnumNodes() {
+        return numNodes;  // Number of intersections in the graph
+    }
+
+    void setReportEdits(bool report) {
+        reportEdits = report;
+    }
+
+    Edges getStreets(int i) {
+        return streets[i];  // Returning the street of required index
+    }
+
+    Nodes* getNode(int i) {
+        return &intersections[i];  // Returning the intersection of required index
+    }
+
+    Nodes* findNode(const string& name) {
+        for (int i = 0; i < numNodes; i++) {  // looping through all nodes to find desired one
+            if (intersections[i].name == name) {
+                  return &intersections[i]; 
+            }
+        }
+    return nullptr;  // If not found
+    }
+
+    int findEdgeIndex(const string& fromName, const string& toName) {
+            for (int i = 0; i < numEdges; i++) {  // Searching for the edge with the matching 'from' and 'to' names.
+                if (intersections[streets[i].from].name == fromName && intersections[streets[i].to].name == toName) {
+                    return i;  
+                }
+            }
+    return -1;  // if not found.
+    }
+
+    int getOccupancySize() {
+        return hashTableSize;
+    }
+
+    int* getOccupancy() {
+        return vehicleCounts;  // Vehicles per road, indexed by hashFunction
+    }
+
+    int getOccupancyIndex(const string& fromName, const string& toName) {
+        return hashFunction(fromName, toName); // Entry of the road in getOccupancy
+    }
+
+    void incrementVehicleCount(const string& fromName, const string& toName) {
+            int index = hashFunction(fromName, toName);  // First, find the index of the edge.
+            vehicleCounts[index]++;  // If the edge exists, increment the vehicle count.
+        }
+
+    void decrementVehicleCount(const string& fromName, const string& toName) {
+        int index = hashFunction(fromName, toName);  // Find the index of the edge.
+        if (vehicleCounts[index] > 0) {
+            vehicleCounts[index]--;  // Decrease the vehicle count if it's above 0.
+        }
+    }
+
+    bool isCongested(const string& fromName, const string& toName) {
+        int index = hashFunction(fromName, toName);  // again finding edge's index first.
+        return vehicleCounts[index] >= streets[findEdgeIndex(fromName, toName)].capacity;  // Return true if the vehicles are more than or equal to capacity.
+    }
+
+    virtual void nodeRemoved(int /*index*/) {} // Called after the intersection at index was deleted and the later ones shifted down
+
+    int findNodeIndex(const string& name) {
+        for (int i = 0; i < numNodes; i++) {  // Searching through nodes by name.
+            if (intersections[i].name == name) {
+                 return i;  // Return the index if found.
+            }
+        }
+        return -1;  // if not found.
+    }
+
+    Route bfs(const string& startName, const string& endName) { // Route over the fewest open roads
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int src = snapshotNodeIndex(snap, startName);  // Find the starting node.
+        int dst = snapshotNodeIndex(snap, endName);  // Find the destination node.
+        if (src == -1 || dst == -1) {
+            unpinSnapshot(readerSlot);
+            return Route();  // If either node is not found, there is no route.
+        }
+
+        int* queue = new int[snap->numNodes];
+        int* predEdge = new int[snap->numNodes];  // Road each node was reached over, -1 while unvisited.
+        for (int i = 0; i < snap->numNodes; i++) predEdge[i] = -1;
+        int front = 0, rear = 0;  // Queue pointers for BFS.
+        queue[rear++] = src;
+        bool found = src == dst;
+        while (front != rear && !found) {  // Standard BFS loop.
+            int u = queue[front++];  // Dequeue the next node.
+            for (int e = snap->firstOut[u]; e < snap->firstOut[u + 1]; e++) {  // Unvisited neighbors over open roads.
+                int v = snap->head[e];
+                if (!snap->isOpen(e) || v == src || predEdge[v] != -1) continue;
+                predEdge[v] = e;
+                queue[rear++] = v;
+                if (v == dst) found = true;
+            }
+        }
+        Route path;
+        if (found) path = routeFromPredecessors(snap, src, dst, predEdge);
+        delete[] queue;
+        delete[] predEdge;
+        unpinSnapshot(readerSlot);
+        return path;
+    }
+
+    void createNode(const string& name, int timings) {
+        createNode(Nodes(name, timings));  // Single phase signal with the default red time.
+    }
+
+    void createNode(const Nodes& signal) {  // Add an intersection with its full signal plan.
+        lock_guard<recursive_mutex> lock(writerMutex);
+        if (findNode(signal.name) != nullptr) {  // Check if the node already exists.
+            cout << "Node with the name '" << signal.name << "' already exists!" << endl;
+            return;
+        }   
+
+        if (numNodes >= MAX_NODES) {  // Node IDs must fit the profile's NodeId type
+            cout << "Error: Node limit of " << MAX_NODES << " reached, '" << signal.name << "' was not added." << endl;
+            return;
+        }
+
+        if (numNodes == nodeCapacity) {  // Resize the array if needed.
+            resizeNodes();
+        }
+
+        intersections[numNodes++] = signal;  // Add the new node.
+        publishSnapshot();
+        if (reportEdits) cout << "Node '" << signal.name << "' has been added." << endl;
+    }
+
+    void createEdges(const string& from, const string& to, int weight, int capacity = DEFAULT_ROAD_CAPACITY, int discharge = DEFAULT_DISCHARGE_RATE) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        int fromNode = findNodeIndex(from);
+        int toNode = findNodeIndex(to);
+        if (weight < 0 || weight > ROUTE_MAX_WEIGHT) {  // Weights must fit the profile's Weight type
+            cout << "Error: Weight " << weight << " for edge '" << from << "' to '" << to << "' is outside 0.." << ROUTE_MAX_WEIGHT << "!" << endl;
+            return;
+        }
+        if (capacity < 1 || capacity > MAX_ROAD_COUNT || discharge < 1 || discharge > MAX_ROAD_COUNT) { // Stored in 16 bits, 0 would block the road for good
+            cout << "Error: Capacity and discharge for edge '" << from << "' to '" << to << "' must be in 1.." << MAX_ROAD_COUNT << "!" << endl;
+            return;
+        }
+
+        if (fromNode != -1 && toNode != -1) {  // Check if both nodes exist.
+            for (int i = 0; i < numEdges; i++) {  // Check if the edge already exists.
+                if (streets[i].from == fromNode && streets[i].to == toNode) {
+                    cout << "Edge from '" << from << "' to '" << to << "' already exists. Updating weight to " << weight << "." << endl;
+                    streets[i].weight = static_cast<Weight>(weight);  // Update the weight if the edge is found.
+                    publishSnapshot();
+                    return;
+                }
+            }
+
+        if (numEdges == edgeCapacity) {  // Resize if needed.
+            resizeEdges();
+        }
+        streets[numEdges++] = Edges(fromNode, toNode, static_cast<Weight>(weight), capacity, discharge);  // Add the new edge.
+        publishSnapshot();
+        if (reportEdits) cout << "Edge from '" << from << "' to '" << to << "' with weight " << weight << " has been added." << endl;
+        }
+        else {
+        cout << "Error: One or both nodes not found!" << endl;
+        }
+    }
+
+    void inputNodes() {
+        cout << "Enter node names (type -1 to stop):" << endl;
+        string name;
+        int timings;
+        while (true) {
+            cout << "Enter node name: ";
+            cin >> name;
+            if (name == "-1") break;  // Break if user types -1.
+            cout << "Enter Green Time: ";
+            cin >> timings;
+            createNode(name, timings);  // Create the node and store in the file.
+            ofstream file("traffic_signal_timings.csv", std::ios::app);
+            file << name << ',' << timings << endl; 
+            file.close();
+        }
+    }
+
+    void inputEdges() {
+        cout << "Enter edges in the format: from to weight (type -1 to stop):" << endl;
+        string from, to;
+        int weight;
+        while (true) {
+            cout << "Enter edge (from to weight): ";
+            cin >> from;
+            if (from == "-1") break;  // Stop if -1 is typed.
+            cin >> to >> weight;
+            createEdges(from, to, weight);  // Create the edge and store in the file.
+            ofstream file("road_network.csv", std::ios::app);
+            file << from << "," << to << "," << weight << endl; 
+            file.close();
+        }
+    }
+
+    void displayGraph() {
+        cout << "Nodes:" << endl;
+        for (int i = 0; i < numNodes; i++) {
+            cout << i << ": " << intersections[i].name << endl;  // Display each node.
+        }
+
+        cout << "Edges:" << endl;
+        for (int i = 0; i < numEdges; i++) {
+            cout << i << ": " << intersections[streets[i].from].name << " -> "
+            << intersections[streets[i].to].name
+            << " (Weight: " << streets[i].weight << ")" << endl;  // Display each edge.
+        }
+    }
+
+
+    void DeleteNode(const string& name) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        int node = findNodeIndex(name); // First, find the node
+        if (node == -1) {
+            cout << "Node not found!" << endl; // If node is not found, show error and return
+            return;
+        }
+
+        int i = 0;
+        while (i < numEdges) { // Loop through all edges to remove the ones connected to this node
+            if (streets[i].from == node || streets[i].to == node) {
+                for (int j = i; j < numEdges - 1; j++) {
+                    streets[j] = streets[j + 1]; // Shift edges to remove the deleted one
+                }
+                numEdges--; // Reduce the edge count
+            } else {
+                i++; // If no match, move to the next edge
+            }
+        }
+
+        int nodeIndex = -1;
+        for (int i = 0; i < numNodes; i++) {
+            if (intersections[i].name == name) {
+                nodeIndex = i; // Get the index of the node to be deleted
+                break;
+            }
+        }
+
+        if (nodeIndex != -1) {
+            for (int i = nodeIndex; i < numNodes - 1; i++) { // Shift nodes to fill the gap of the deleted node
+                intersections[i] = intersections[i + 1];
+            }
+            numNodes--; // Reduce the node count
+            for (int i = 0; i < numEdges; i++) { // Roads to shifted nodes move down with them
+                if (streets[i].from > node) streets[i].from--;
+                if (streets[i].to > node) streets[i].to--;
+            }
+            nodeRemoved(nodeIndex);
+        }
+        publishSnapshot();
+
+        /* Update the node and 
+        edge files after deletion*/
+        updateNodeFile(name);
+        updateEdgeFile(name);
+        cout << "Node " << name << " and its associated edges have been deleted." << endl;
+    }
+
+    void traffic_signal_timings(const string& fileName = "traffic_signal_timings.csv") {
+        ifstream file1(fileName);
+        string node;
+        int timings;
+        if (file1.good()) {
+            string header;
+            getline(file1, header); // Skip the header row
+        }
+        
+        beginBatchEdit(); // Publish one snapshot for the whole file
+        while (file1.good()) {
+            getline(file1, node, ','); // Read node name
+            file1 >> timings;
+            Nodes signal(node, timings);
+            int cycle = 0;
+            if (file1.peek() == ',') { // Optional offset column
+                file1.ignore(1);
+                file1 >> signal.offset;
+            }
+            if (file1.peek() == ',') { // Optional cycle length column
+                file1.ignore(1);
+                file1 >> cycle;
+            }
+            if (file1.peek() == ',') { // Optional phase greens column, e.g. 30;20
+                file1.ignore(1);
+                signal.numPhases = 0;
+                int green;
+                while (signal.numPhases < MAX_PHASES && file1 >> green) {
+                    signal.phaseGreen[signal.numPhases++] = green;
+                    if (file1.peek() != ';') break;
+                    file1.ignore(1);
+                }
+                file1.clear();
+                if (signal.numPhases == 0) signal.phaseGreen[signal.numPhases++] = timings;
+                signal.timing = signal.phaseGreen[0];
+            }
+            file1.ignore(__LONG_MAX__, '\n'); // Move to the next line
+
+            int totalGreen = 0;
+            for (int p = 0; p < signal.numPhases; p++) totalGreen += signal.phaseGreen[p];
+            signal.cycle = cycle > 0 ? cycle : totalGreen + DEFAULT_RED_DURATION;
+            if (signal.cycle < totalGreen) signal.cycle = totalGreen; // Phases must fit in the cycle
+            if (signal.cycle < 1) signal.cycle = 1;
+            if (!node.empty()) {
+                createNode(signal); // Create node with the read data
+            }
+        }
+        endBatchEdit();
+    }
+
+    void road_Network(const string& fileName = "road_network.csv") {
+        ifstream file(fileName);
+        string from_node, to_node;
+        int weight;
+        int capacity, discharge;
+
+        if (file.good()) {
+            string header;
+            getline(file, header); // Skip the header row
+        }
+
+        beginBatchEdit(); // Publish one snapshot for the whole file
+        while (file.good()) {
+            getline(file, from_node, ','); 
+            getline(file, to_node, ','); 
+            file >> weight; 
+            capacity = DEFAULT_ROAD_CAPACITY;
+            discharge = DEFAULT_DISCHARGE_RATE;
+            if (file.peek() == ',') { // Optional capacity column, in vehicles
+                file.ignore(1);
+                file >> capacity;
+            }
+            if (file.peek() == ',') { // Optional discharge rate column, in vehicles per second of green
+                file.ignore(1);
+                file >> discharge;
+            }
+            file.ignore(__LONG_MAX__, '\n'); // Move to the next line
+            if (!from_node.empty() && !to_node.empty()) {
+                createEdges(from_node, to_node, weight, capacity, discharge); // Create edge with the read data
+            }
+        }
+        endBatchEdit();
+        file.close();
+    }
+
+    Edges* findEdge(int from, int to) {
+        for (int i = 0; i < numEdges; i++) { // Find the edge that connects two nodes
+            if (streets[i].from == from && streets[i].to == to) {
+                return &streets[i]; // Return the edge if found
+            }
+        }
+        return nullptr; // if no edge is found
     }
 
     void DeleteEdge(const string& fromNode, const string& toNode, int weight) {
+        lock_guard<recursive_mutex> lock(writerMutex);
         bool edgeDeleted = false;
         int i = 0;
         /*Loop through edges to find the one that
          matches the 'from', 'to', and 'weight'*/ 
         while (i < numEdges) {
-            if (streets[i].from->name == fromNode && streets[i].to->name == toNode && streets[i].weight == weight) {
+            if (intersections[streets[i].from].name == fromNode && intersections[streets[i].to].name == toNode && streets[i].weight == weight) {
                 for (int j = i; j < numEdges - 1; j++) {
                     streets[j] = streets[j + 1]; // Shift edges to remove the one being deleted
                 }
-                numEdges--; // Reduce edge count
-                edgeDeleted = true;
-                cout << "Edge " << fromNode << " -> " << toNode << " (Weight: " << weight << ") has been deleted from the graph." << endl;
+                numEdges--; // Reduce edge count
+                edgeDeleted = true;
+                cout << "Edge " << fromNode << " -> " << toNode << " (Weight: " << weight << ") has been deleted from the graph." << endl;
+            } else {
+                i++; // Move to the next edge if no match
+            }
+        }
+
+        if (!edgeDeleted) {
+            cout << "No edge found between " << fromNode << " and " << toNode << " with weight " << weight << "." << endl;
+        } else {
+            publishSnapshot();
+        }
+
+        updateEdgeFile(fromNode); // Update the edge file after deletion
+    }
+
+    void updateEdgeFile(const string& nodeName) {
+        ifstream infile("road_network.csv");
+        ofstream outfile("temp.csv");
+
+        string from, to, header, rest;
+
+        if (getline(infile, header)) {
+            outfile << header << endl; // Copy the header to the temp file
+        }
+
+        /* Copy all edges except the
+         ones related to 'nodeName'*/
+        while (getline(infile, from, ',')) {
+            getline(infile, to, ',');
+            getline(infile, rest); // Weight and the optional columns
+
+            if (from == nodeName || to == nodeName) {
+                continue; // Skip if it's the edge to delete
+            }
+
+            outfile << from << "," << to << "," << rest << endl; // Write the valid edge to the temp file
+        }
+
+        infile.close();
+        outfile.close();
+
+        remove("road_network.csv"); // Delete old file
+        rename("temp.csv", "road_network.csv"); // Rename temp file to original file name
+    }
+
+    void updateNodeFile(const string& nodeName) {
+        ifstream infile("traffic_signal_timings.csv");
+        ofstream outfile("temp.csv");
+
+        string node;
+        int timings;
+
+        bool headerRead = false;
+
+        while (infile.good()) {
+            if (!headerRead) {
+                string header;
+                getline(infile, header);
+                outfile << header << endl; // Write the header to the temp file
+                headerRead = true;
+            }
+            
+            getline(infile, node, ','); // Read node name
+            if (node.empty()) continue; // Skip if node is empty
+            
+            infile >> timings; // Read timings
+            string offsetColumn;
+            getline(infile, offsetColumn); // Rest of the line, e.g. an optimizer offset
+
+            if (node != nodeName) {
+                outfile << node << "," << timings << offsetColumn << endl; // Write the valid node to the temp file
+            }
+        }
+
+        infile.close();
+        outfile.close();
+
+        remove("traffic_signal_timings.csv"); // Delete old file
+        rename("temp.csv", "traffic_signal_timings.csv"); // Rename temp file to original file name
+    }
+
+    Route dijkstra(const string& fromNodeName, const string& toNodeName, Distance& pathLength) {
+        const GraphSnapshot* snap; // Route on a pinned snapshot so edits can't change the graph mid-search
+        int readerSlot = pinSnapshot(snap);
+        int startIdx = snapshotNodeIndex(snap, fromNodeName); // Find the index of the start and end nodes
+        int endIdx = snapshotNodeIndex(snap, toNodeName);
+        /*If start or end node is not found,
+         release the snapshot and return no route*/ 
+        if (startIdx == -1 || endIdx == -1) {
+            unpinSnapshot(readerSlot);
+            pathLength = 0;
+            return Route();
+        }
+
+        Distance* dist = new Distance[snap->numNodes]; // Distance array for shortest paths
+        int* predEdge = new int[snap->numNodes]; // Edge slot used to reach each node
+        Route path;
+        cachedShortestRoute(routeCache, snap, snap->version, startIdx, endIdx, dist, predEdge, relaxKernel, path, pathLength); // 0 and no route when unreachable
+
+        // Free memory
+        delete[] dist;
+        delete[] predEdge;
+        unpinSnapshot(readerSlot);
+
+        return path; // Return the shortest path
+    }
+
+    /* Shortest route from src to dst on a pinned snapshot. Taken from cache
+     when it holds one found on the given version (the snapshot's own unless a
+     benchmark says otherwise), otherwise searched with dist and predEdge as
+     work arrays and stored. Returns false, with no route and a distance of 0,
+     when dst can't be reached*/
+    bool cachedShortestRoute(RouteCache& cache, const GraphSnapshot* snap, long long version, int src, int dst, Distance* dist,
+                             int* predEdge, RelaxKernel kernel, Route& route, Distance& distance) {
+        long long cost;
+        if (!cache.lookup(src, dst, ROUTE_CACHE_STATIC, version, route, cost)) {
+            snapshotDijkstra(snap, src, dist, predEdge, kernel, dst);
+            cost = dist[dst] == ROUTE_INF ? -1 : dist[dst];
+            route = cost == -1 ? Route() : routeFromPredecessors(snap, src, dst, predEdge);
+            cache.insert(src, dst, ROUTE_CACHE_STATIC, version, route, cost);
+        }
+        distance = cost == -1 ? 0 : static_cast<Distance>(cost);
+        return cost != -1;
+    }
+
+    RouteCache& getRouteCache() { return routeCache; }
+
+    void displayRouteCacheStats(ostream& out = cout) {
+        long long hits, misses, stale, evictions, bytes;
+        int entries;
+        routeCache.summary(hits, misses, stale, evictions, entries, bytes);
+        out << "Route cache: " << entries << " of " << routeCache.capacity() << " routes held, " << hits << " hits, " << misses
+            << " misses (" << stale << " on routes of an older graph version), hit rate "
+            << (hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0) << "%, " << evictions << " evicted, "
+            << bytes / 1024 << " KB" << endl;
+    }
+
+    void displayRoute(const Route& route, ostream& out = cout, const char* separator = " -> ") { // Prints the intersections, e.g. A -> B -> C
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        if (route.version != snap->version) {
+            out << "(the roads changed since the route was found)";
+        } else {
+            for (int i = 0; i <= route.length; i++) {
+                out << snap->nodes[route.node(snap, i)].name;
+                if (i < route.length) out << separator;
+            }
+        }
+        unpinSnapshot(readerSlot);
+    }
+
+    /* One-to-all shortest paths on a pinned snapshot using a binary heap. The
+     roads of every settled node are relaxed by the given kernel. With a target
+     the search stops as soon as the target is settled. A given routeWeight
+     replaces the snapshot's weights, e.g. a scenario's own copy*/
+    void snapshotDijkstra(const GraphSnapshot* snap, int src, Distance* dist, int* predEdge, RelaxKernel kernel, int target = -1,
+                          const Weight* routeWeight = nullptr) {
+        int n = snap->numNodes;
+        const Weight* weights = routeWeight != nullptr ? routeWeight : snap->routeWeight;
+        for (int i = 0; i < n; i++) {
+            dist[i] = ROUTE_INF;
+            predEdge[i] = -1;
+        }
+        int* improved = new int[snap->numEdges > 0 ? snap->numEdges : 1]; // Heads lowered by one relaxation
+        MinHeap<Distance> heap(n);
+        dist[src] = 0;
+        heap.push(0, src);
+
+        while (!heap.empty()) {
+            Distance d;
+            int u;
+            heap.pop(d, u);
+            if (d > dist[u]) continue; // Stale heap entry
+            if (u == target) break;
+            int count = kernel(d, snap->firstOut[u], snap->firstOut[u + 1], snap->head, weights,
+                               0, ROUTE_MAX_WEIGHT, dist, predEdge, improved);
+            for (int j = 0; j < count; j++) heap.push(dist[improved[j]], improved[j]);
+        }
+        delete[] improved;
+    }
+
+    /* Bellman-Ford style one-to-all search: sweep over all reached nodes and
+     relax their roads until a sweep changes nothing. Returns the number of sweeps*/
+    int snapshotBellmanFord(const GraphSnapshot* snap, int src, Distance* dist, int* predEdge, RelaxKernel kernel) {
+        int n = snap->numNodes;
+        for (int i = 0; i < n; i++) {
+            dist[i] = ROUTE_INF;
+            predEdge[i] = -1;
+        }
+        int* improved = new int[snap->numEdges > 0 ? snap->numEdges : 1];
+        dist[src] = 0;
+        int sweeps = 0;
+        bool changed = true;
+        while (changed && sweeps < n) {
+            changed = false;
+            sweeps++;
+            for (int u = 0; u < n; u++) {
+                if (dist[u] == ROUTE_INF) continue;
+                if (kernel(dist[u], snap->firstOut[u], snap->firstOut[u + 1], snap->head, snap->routeWeight,
+                           0, ROUTE_MAX_WEIGHT, dist, predEdge, improved) > 0) {
+                    changed = true;
+                }
+            }
+        }
+        delete[] improved;
+        return sweeps;
+    }
+
+    /* Delta-stepping one-to-all search: nodes sit in buckets of width delta. A
+     bucket is emptied by repeatedly relaxing the light roads (weight <= delta)
+     of its nodes, then the heavy roads of everything it settled are relaxed once.
+     An entry is stale once its node moved to a lower bucket*/
+    void snapshotDeltaStepping(const GraphSnapshot* snap, int src, int delta, Distance* dist, int* predEdge, RelaxKernel kernel) {
+        int n = snap->numNodes;
+        if (delta < 1) delta = 1;
+        if (delta > ROUTE_MAX_WEIGHT) delta = ROUTE_MAX_WEIGHT; // Light roads are those up to delta, so it must fit a Weight
+        int maxWeight = 1;
+        for (int e = 0; e < snap->numEdges; e++) {
+            if (snap->routeWeight[e] != ROUTE_BLOCKED && snap->routeWeight[e] > maxWeight) maxWeight = snap->routeWeight[e];
+        }
+        int numBuckets = maxWeight / delta + 2; // Cyclic buckets, enough to hold every distance still ahead
+        BucketLists buckets(numBuckets, n + 16);
+        int* settled = new int[n];  // Nodes emptied from the current bucket
+        Distance* settledMark = new Distance[n]; // Bucket that last settled each node
+        int* improved = new int[snap->numEdges > 0 ? snap->numEdges : 1];
+        for (int i = 0; i < n; i++) {
+            dist[i] = ROUTE_INF;
+            predEdge[i] = -1;
+            settledMark[i] = ROUTE_INF;
+        }
+        dist[src] = 0;
+        buckets.push(0, src);
+
+        for (Distance bucket = 0; buckets.live > 0; bucket++) {
+            int slot = static_cast<int>(bucket % numBuckets);
+            int numSettled = 0;
+            while (buckets.head[slot] != -1) {
+                int entry = buckets.take(slot); // New light entries start a fresh list
+                for (; entry != -1; entry = buckets.entryNext[entry]) {
+                    int v = buckets.entryNode[entry];
+                    buckets.live--;
+                    if (dist[v] / delta != bucket) continue; // Stale entry
+                    if (settledMark[v] != bucket) {
+                        settledMark[v] = bucket;
+                        settled[numSettled++] = v;
+                    }
+                    int count = kernel(dist[v], snap->firstOut[v], snap->firstOut[v + 1], snap->head, snap->routeWeight,
+                                       0, delta, dist, predEdge, improved);
+                    for (int j = 0; j < count; j++) buckets.push((dist[improved[j]] / delta) % numBuckets, improved[j]);
+                }
+            }
+            for (int i = 0; i < numSettled; i++) { // Heavy roads always land in a later bucket
+                int v = settled[i];
+                int count = kernel(dist[v], snap->firstOut[v], snap->firstOut[v + 1], snap->head, snap->routeWeight,
+                                   delta + 1, ROUTE_MAX_WEIGHT, dist, predEdge, improved);
+                for (int j = 0; j < count; j++) buckets.push((dist[improved[j]] / delta) % numBuckets, improved[j]);
+            }
+        }
+
+        delete[] settled;
+        delete[] settledMark;
+        delete[] improved;
+    }
+
+    /* Heap based Dijkstra that skips banned nodes and edges (the spur search of Yen's
+     algorithm) over a pinned snapshot. Writes the snapshot edge slots of the path into pathEdges and returns its
+     cost, or ROUTE_INF if the destination can't be reached*/
+    Distance restrictedShortestPath(const GraphSnapshot* snap, int src, int dst,
+                                    const bool* bannedNode, const bool* bannedEdge,
+                                    Distance* dist, int* predEdge, MinHeap<Distance>& heap, int* pathEdges, int& pathEdgeCount) {
+        for (int i = 0; i < snap->numNodes; i++) {
+            dist[i] = ROUTE_INF;
+            predEdge[i] = -1;
+        }
+        heap.clear();
+        dist[src] = 0;
+        heap.push(0, src);
+
+        while (!heap.empty()) {
+            Distance d;
+            int u;
+            heap.pop(d, u);
+            if (d > dist[u]) continue; // Stale heap entry
+            if (u == dst) break;
+
+            for (int e = snap->firstOut[u]; e < snap->firstOut[u + 1]; e++) { // Relax every usable out-edge
+                if (!snap->isOpen(e) || bannedEdge[e]) continue;
+                int v = snap->head[e];
+                if (bannedNode[v]) continue;
+                if (d + snap->weight[e] < dist[v]) {
+                    dist[v] = d + snap->weight[e];
+                    predEdge[v] = e;
+                    heap.push(dist[v], v);
+                }
+            }
+        }
+
+        pathEdgeCount = 0;
+        if (dist[dst] == ROUTE_INF) return ROUTE_INF;
+        for (int v = dst; v != src; v = snap->tail[predEdge[v]]) pathEdgeCount++;
+        int pos = pathEdgeCount;
+        for (int v = dst; v != src; v = snap->tail[predEdge[v]]) pathEdges[--pos] = predEdge[v];
+        return dist[dst];
+    }
+
+    /* Find up to k short and sufficiently different routes between two nodes.
+     Routes are generated in cost order with Yen's algorithm; each spur search reuses
+     the root prefix shared with its parent route and only starts at the parent's
+     deviation point (Lawler's refinement). A route is kept only if at most maxOverlap
+     of its travel time is shared with an already kept route, and it costs no more
+     than maxStretch times the shortest route. The search runs on a pinned snapshot,
+     so edits made meanwhile don't disturb it. routes must have room for k
+     routes. Returns the number found*/
+    int kAlternativeRoutes(const string& fromName, const string& toName, int k, Route* routes, long long* costs,
+                           double maxOverlap = 0.6, double maxStretch = 1.5) {
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int src = snapshotNodeIndex(snap, fromName);
+        int dst = snapshotNodeIndex(snap, toName);
+        if (src == -1 || dst == -1 || k <= 0) {
+            unpinSnapshot(readerSlot);
+            return 0;
+        }
+        int numNodes = snap->numNodes; // Sizes of the pinned version, not the live graph
+        int numEdges = snap->numEdges;
+
+        bool* bannedNode = new bool[numNodes];
+        bool* bannedEdge = new bool[numEdges > 0 ? numEdges : 1];
+        int* edgeMark = new int[numEdges > 0 ? numEdges : 1];
+        for (int i = 0; i < numNodes; i++) bannedNode[i] = false;
+        for (int i = 0; i < numEdges; i++) {
+            bannedEdge[i] = false;
+            edgeMark[i] = 0;
+        }
+        Distance* dist = new Distance[numNodes];
+        int* predEdge = new int[numNodes];
+        int* pathNodes = new int[numNodes + 1];
+        int* spurEdges = new int[numNodes];
+        MinHeap<Distance> heap(numNodes);
+
+        /* Yen's list of generated routes (in cost order) and the candidate pool.
+         Every route is an array of edge indices plus its cost and deviation index*/
+        int maxGenerated = k * 4 + 4;
+        int** genEdges = new int*[maxGenerated];
+        int* genLen = new int[maxGenerated];
+        long long* genCost = new long long[maxGenerated]; // Root plus spur, can pass a Distance
+        int* genDev = new int[maxGenerated];
+        int genCount = 0;
+
+        int candCapacity = 16, candCount = 0;
+        int** candEdges = new int*[candCapacity];
+        int* candLen = new int[candCapacity];
+        long long* candCost = new long long[candCapacity];
+        int* candDev = new int[candCapacity];
+
+        int* keptIdx = new int[k]; // Generated routes that passed the diversity filter
+        int keptCount = 0;
+        int markStamp = 0;
+
+        int len = 0;
+        Distance cost = restrictedShortestPath(snap, src, dst, bannedNode, bannedEdge, dist, predEdge, heap, spurEdges, len);
+        if (cost != ROUTE_INF) {
+            genEdges[0] = new int[len > 0 ? len : 1];
+            for (int i = 0; i < len; i++) genEdges[0][i] = spurEdges[i];
+            genLen[0] = len;
+            genCost[0] = cost;
+            genDev[0] = 0;
+            genCount = 1;
+            keptIdx[keptCount++] = 0; // The shortest route is always kept
+        }
+        long long costLimit = static_cast<long long>(cost * maxStretch);
+
+        for (int g = 0; g < genCount && keptCount < k && genCount < maxGenerated; g++) {
+            int* path = genEdges[g];
+            int pathLen = genLen[g];
+            pathNodes[0] = src;
+            for (int i = 0; i < pathLen; i++) pathNodes[i + 1] = snap->head[path[i]];
+
+            /* The root prefix up to the deviation point was already explored
+             from the parent route, so it is banned once and extended as we go*/
+            long long rootCost = 0;
+            for (int i = 0; i < genDev[g]; i++) {
+                bannedNode[pathNodes[i]] = true;
+                rootCost += snap->weight[path[i]];
+            }
+
+            for (int i = genDev[g]; i < pathLen; i++) {
+                for (int q = 0; q < genCount; q++) { // Ban the next edge of every route sharing this root
+                    if (genLen[q] <= i) continue;
+                    bool sameRoot = true;
+                    for (int j = 0; j < i && sameRoot; j++) sameRoot = genEdges[q][j] == path[j];
+                    if (sameRoot) bannedEdge[genEdges[q][i]] = true;
+                }
+
+                int spurLen = 0;
+                Distance spurCost = restrictedShortestPath(snap, pathNodes[i], dst, bannedNode, bannedEdge,
+                                                           dist, predEdge, heap, spurEdges, spurLen);
+
+                for (int q = 0; q < genCount; q++) { // Lift the edge bans again
+                    if (genLen[q] > i) bannedEdge[genEdges[q][i]] = false;
+                }
+
+                if (spurCost != ROUTE_INF && rootCost + spurCost <= costLimit) {
+                    int newLen = i + spurLen;
+                    bool duplicate = false;
+                    for (int c = 0; c < candCount && !duplicate; c++) {
+                        if (candLen[c] != newLen || candCost[c] != rootCost + spurCost) continue;
+                        duplicate = true;
+                        for (int j = 0; j < newLen && duplicate; j++) {
+                            int e = j < i ? path[j] : spurEdges[j - i];
+                            duplicate = candEdges[c][j] == e;
+                        }
+                    }
+                    if (!duplicate) {
+                        if (candCount == candCapacity) { // Grow the candidate pool
+                            candCapacity *= 2;
+                            int** newEdges = new int*[candCapacity];
+                            int* newLens = new int[candCapacity];
+                            long long* newCosts = new long long[candCapacity];
+                            int* newDevs = new int[candCapacity];
+                            for (int c = 0; c < candCount; c++) {
+                                newEdges[c] = candEdges[c];
+                                newLens[c] = candLen[c];
+                                newCosts[c] = candCost[c];
+                                newDevs[c] = candDev[c];
+                            }
+                            delete[] candEdges;
+                            delete[] candLen;
+                            delete[] candCost;
+                            delete[] candDev;
+                            candEdges = newEdges;
+                            candLen = newLens;
+                            candCost = newCosts;
+                            candDev = newDevs;
+                        }
+                        candEdges[candCount] = new int[newLen > 0 ? newLen : 1];
+                        for (int j = 0; j < i; j++) candEdges[candCount][j] = path[j]; // Shared root prefix
+                        for (int j = 0; j < spurLen; j++) candEdges[candCount][i + j] = spurEdges[j];
+                        candLen[candCount] = newLen;
+                        candCost[candCount] = rootCost + spurCost;
+                        candDev[candCount] = i;
+                        candCount++;
+                    }
+                }
+
+                bannedNode[pathNodes[i]] = true; // The spur node joins the root for the next step
+                rootCost += snap->weight[path[i]];
+            }
+            for (int i = 0; i < pathLen; i++) bannedNode[pathNodes[i]] = false;
+
+            if (candCount == 0) break;
+            int best = 0;
+            for (int c = 1; c < candCount; c++) { // Cheapest candidate becomes the next generated route
+                if (candCost[c] < candCost[best]) best = c;
+            }
+            genEdges[genCount] = candEdges[best];
+            genLen[genCount] = candLen[best];
+            genCost[genCount] = candCost[best];
+            genDev[genCount] = candDev[best];
+            candCount--;
+            candEdges[best] = candEdges[candCount];
+            candLen[best] = candLen[candCount];
+            candCost[best] = candCost[candCount];
+            candDev[best] = candDev[candCount];
+
+            /* Keep the route only if it is different enough
+             from every route that was already kept*/
+            int newest = genCount++;
+            bool diverse = true;
+            for (int r = 0; r < keptCount && diverse; r++) {
+                markStamp++;
+                for (int j = 0; j < genLen[keptIdx[r]]; j++) edgeMark[genEdges[keptIdx[r]][j]] = markStamp;
+                long long shared = 0;
+                for (int j = 0; j < genLen[newest]; j++) {
+                    if (edgeMark[genEdges[newest][j]] == markStamp) shared += snap->weight[genEdges[newest][j]];
+                }
+                if (genCost[newest] > 0 && shared > maxOverlap * genCost[newest]) diverse = false;
+            }
+            if (diverse) keptIdx[keptCount++] = newest;
+        }
+
+        for (int r = 0; r < keptCount; r++) { // Hand out the kept routes
+            int idx = keptIdx[r];
+            routes[r] = Route(genLen[idx], src, snap->version);
+            for (int j = 0; j < genLen[idx]; j++) routes[r].edges[j] = genEdges[idx][j];
+            costs[r] = genCost[idx];
+        }
+
+        for (int g = 0; g < genCount; g++) delete[] genEdges[g]; // Free memory
+        for (int c = 0; c < candCount; c++) delete[] candEdges[c];
+        delete[] genEdges;
+        delete[] genLen;
+        delete[] genCost;
+        delete[] genDev;
+        delete[] candEdges;
+        delete[] candLen;
+        delete[] candCost;
+        delete[] candDev;
+        delete[] keptIdx;
+        delete[] bannedNode;
+        delete[] bannedEdge;
+        delete[] edgeMark;
+        delete[] dist;
+        delete[] predEdge;
+        delete[] pathNodes;
+        delete[] spurEdges;
+
+        unpinSnapshot(readerSlot);
+        return keptCount;
+    }
+
+    int snapshotEdgeSlot(const GraphSnapshot* snap, int from, int to) {
+        for (int e = snap->firstOut[from]; e < snap->firstOut[from + 1]; e++) {  // Only the from node's out-edges
+            if (snap->head[e] == to) {
+                return e;
+            }
+        }
+        return -1;  // if not found.
+    }
+
+    /* Calculate how long a vehicle arriving over edge slot e at arrival_time
+     waits for its phase to turn green. A lookup in the precomputed wait table,
+     shared by the simulator and the time dependent router. Times before 0
+     fall in the cycle the same way later ones do*/
+    int calculate_wait_time(const GraphSnapshot* snap, int e, long long arrival_time) {
+        int cycle = snap->signalCycle[e];
+        int inCycle = static_cast<int>(arrival_time % cycle);
+        if (inCycle < 0) inCycle += cycle; // % keeps the sign of a negative time
+        return snap->waitTable[snap->signalBase[e] + inCycle];
+    }
+
+    /* Check if the traffic light is green when 
+    a vehicle arrives over edge slot e*/
+    bool is_light_green(const GraphSnapshot* snap, int e, long long arrival_time) {
+        return calculate_wait_time(snap, e, arrival_time) == 0;
+    }
+
+    /* Fastest route when leaving at departure_time. Dijkstra on arrival times,
+     where a road costs its travel time plus the wait at the signal at its end;
+     waiting never lets a later vehicle overtake, so the search stays exact.
+     Departures in the same ROUTE_CACHE_TIME_BUCKET share a cached route, which
+     is retimed for the exact departure. Arrival times are long long, so late
+     departures over slow roads can't overflow. Returns the travel time (or -1) and the route*/
+    long long timeDependentRoute(const string& fromName, const string& toName, int departure_time, Route& path) {
+        const long long ARRIVAL_INF = numeric_limits<long long>::max(); // Not reached yet
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int src = snapshotNodeIndex(snap, fromName);
+        int dst = snapshotNodeIndex(snap, toName);
+        path = Route();
+        if (src == -1 || dst == -1) {
+            unpinSnapshot(readerSlot);
+            return -1;
+        }
+        bool cacheable = departure_time >= 0;
+        int timeBucket = departure_time / ROUTE_CACHE_TIME_BUCKET;
+        long long cachedTime;
+        if (cacheable && routeCache.lookup(src, dst, timeBucket, snap->version, path, cachedTime)) {
+            long long travel_time = -1;
+            if (path.found()) { // Drive the cached roads leaving at departure_time
+                long long t = departure_time;
+                for (int i = 0; i < path.length; i++) {
+                    t += snap->weight[path.edges[i]];
+                    t += calculate_wait_time(snap, path.edges[i], t);
+                }
+                travel_time = t - departure_time;
+            }
+            unpinSnapshot(readerSlot);
+            return travel_time;
+        }
+
+        int n = snap->numNodes;
+        long long* arrival = new long long[n];
+        int* predEdge = new int[n];
+        for (int i = 0; i < n; i++) {
+            arrival[i] = ARRIVAL_INF;
+            predEdge[i] = -1;
+        }
+        MinHeap<long long> heap(n);
+        arrival[src] = departure_time;
+        heap.push(departure_time, src);
+
+        while (!heap.empty()) {
+            long long t;
+            int u;
+            heap.pop(t, u);
+            if (t > arrival[u]) continue; // Stale heap entry
+            if (u == dst) break;
+            for (int e = snap->firstOut[u]; e < snap->firstOut[u + 1]; e++) {
+                if (!snap->isOpen(e)) continue;
+                long long reach = t + snap->weight[e];
+                reach += calculate_wait_time(snap, e, reach); // Wait for the green at the next intersection
+                int v = snap->head[e];
+                if (reach < arrival[v]) {
+                    arrival[v] = reach;
+                    predEdge[v] = e;
+                    heap.push(reach, v);
+                }
+            }
+        }
+
+        long long travel_time = -1;
+        if (arrival[dst] != ARRIVAL_INF) {
+            travel_time = arrival[dst] - departure_time;
+            path = routeFromPredecessors(snap, src, dst, predEdge);
+        }
+        if (cacheable) routeCache.insert(src, dst, timeBucket, snap->version, path, travel_time);
+
+        delete[] arrival;
+        delete[] predEdge;
+        unpinSnapshot(readerSlot);
+        return travel_time;
+    }
+
+    const char* relaxKernelName() {
+#ifdef HAVE_AVX2_KERNEL
+        if (relaxKernel == relaxEdgesAVX2) return "AVX2";
+#endif
+        return "scalar";
+    }
+
+    /* Run Dijkstra, Bellman-Ford and delta-stepping with the scalar kernel and
+     with the kernel picked for this CPU, check that distances and predecessors
+     are bit-for-bit the same, and time both. Returns false on any mismatch*/
+    bool benchmarkSnapshotKernels(const string& label, const GraphSnapshot* snap, int numSources, bool withBellmanFord) {
+        int n = snap->numNodes;
+        if (n == 0) return true;
+        long long weightSum = 0;
+        int activeRoads = 0;
+        for (int e = 0; e < snap->numEdges; e++) {
+            if (snap->routeWeight[e] == ROUTE_BLOCKED) continue;
+            weightSum += snap->routeWeight[e];
+            activeRoads++;
+        }
+        int delta = activeRoads > 0 ? static_cast<int>(weightSum / activeRoads) : 1; // Average road as bucket width
+        if (delta < 1) delta = 1;
+        if (numSources > n) numSources = n;
+
+        Distance* scalarDist = new Distance[n];
+        int* scalarPred = new int[n];
+        Distance* fastDist = new Distance[n];
+        int* fastPred = new int[n];
+        Distance* referenceDist = new Distance[n];
+        bool allMatch = true;
+
+        cout << label << ": " << n << " nodes, " << snap->numEdges << " roads, " << numSources << " sources, delta " << delta << endl;
+        for (int algorithm = 0; algorithm < 3; algorithm++) {
+            if (algorithm == 1 && !withBellmanFord) {
+                cout << "  Bellman-Ford      skipped on a graph this large" << endl;
+                continue;
+            }
+            double scalarTime = 0, fastTime = 0;
+            bool identical = true, sameDistances = true;
+            for (int s = 0; s < numSources; s++) {
+                int src = static_cast<int>(static_cast<long long>(s) * n / numSources);
+                for (int pass = 0; pass < 2; pass++) {
+                    RelaxKernel kernel = pass == 0 ? relaxEdgesScalar<NodeId, Weight> : relaxKernel;
+                    Distance* dist = pass == 0 ? scalarDist : fastDist;
+                    int* pred = pass == 0 ? scalarPred : fastPred;
+                    auto start = chrono::high_resolution_clock::now();
+                    if (algorithm == 0) snapshotDijkstra(snap, src, dist, pred, kernel);
+                    else if (algorithm == 1) snapshotBellmanFord(snap, src, dist, pred, kernel);
+                    else snapshotDeltaStepping(snap, src, delta, dist, pred, kernel);
+                    chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+                    (pass == 0 ? scalarTime : fastTime) += elapsed.count();
+                }
+                if (memcmp(scalarDist, fastDist, n * sizeof(Distance)) != 0 || memcmp(scalarPred, fastPred, n * sizeof(int)) != 0) {
+                    identical = false;
+                }
+                if (algorithm != 0) { // Other searches may pick other tied routes, but never other distances
+                    snapshotDijkstra(snap, src, referenceDist, fastPred, relaxEdgesScalar<NodeId, Weight>);
+                    if (memcmp(referenceDist, scalarDist, n * sizeof(Distance)) != 0) sameDistances = false;
+                }
+            }
+            const char* names[3] = {"Dijkstra", "Bellman-Ford", "Delta-stepping"};
+            cout << "  " << names[algorithm];
+            for (int pad = static_cast<int>(strlen(names[algorithm])); pad < 18; pad++) cout << ' ';
+            cout << "scalar " << scalarTime << " ms, " << relaxKernelName() << " " << fastTime << " ms";
+            if (fastTime > 0) cout << " (x" << scalarTime / fastTime << ")";
+            cout << (identical ? ", identical" : ", MISMATCH");
+            if (!sameDistances) cout << ", distances differ from Dijkstra";
+            cout << endl;
+            allMatch = allMatch && identical && sameDistances;
+        }
+
+        delete[] scalarDist;
+        delete[] scalarPred;
+        delete[] fastDist;
+        delete[] fastPred;
+        delete[] referenceDist;
+        return allMatch;
+    }
+
+    void benchmarkRelaxKernels() {
+        cout << "Relaxation kernel for this CPU: " << relaxKernelName() << endl;
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        bool ok = benchmarkSnapshotKernels("Road network", snap, snap->numNodes, true);
+        unpinSnapshot(readerSlot);
+
+        GraphSnapshot* small = buildSyntheticSnapshot(5000, 8, 100, 12345);
+        ok = benchmarkSnapshotKernels("Synthetic network", small, 16, true) && ok;
+        delete small;
+        GraphSnapshot* large = buildSyntheticSnapshot(200000, 16, 100, 54321);
+        ok = benchmarkSnapshotKernels("Synthetic network", large, 8, false) && ok;
+        delete large;
+        cout << (ok ? "All kernels agree bit-for-bit." : "Kernel results differ!") << endl;
+    }
+
+    /* Average open road weight, a good default bucket width for delta-stepping*/
+    int defaultDelta(const GraphSnapshot* snap) {
+        long long weightSum = 0;
+        int activeRoads = 0;
+        for (int e = 0; e < snap->numEdges; e++) {
+            if (snap->routeWeight[e] == ROUTE_BLOCKED) continue;
+            weightSum += snap->routeWeight[e];
+            activeRoads++;
+        }
+        int delta = activeRoads > 0 ? static_cast<int>(weightSum / activeRoads) : 1;
+        return delta < 1 ? 1 : delta;
+    }
+
+    /* Parallel delta-stepping. Distance and predecessor of a node are packed into
+     one 64 bit word (distance in the high half) and lowered with compare-and-swap,
+     so both always describe the same route. The threads take chunks of the current
+     frontier and relax them; between phases thread 0 merges the nodes they lowered
+     into the next frontier or a later bucket. A bucket is done when its light roads
+     (weight <= delta) stop lowering anything, then the heavy roads of every node it
+     settled are relaxed in one more phase*/
+    void snapshotParallelDeltaStepping(const GraphSnapshot* snap, int src, int delta, int numThreads, Distance* dist, int* predEdge) {
+        int n = snap->numNodes;
+        if (n == 0) return;
+        if (delta < 1) delta = 1;
+        if (delta > ROUTE_MAX_WEIGHT) delta = ROUTE_MAX_WEIGHT;
+        if (numThreads < 1) numThreads = 1;
+        int maxWeight = 1;
+        for (int e = 0; e < snap->numEdges; e++) {
+            if (snap->routeWeight[e] != ROUTE_BLOCKED && snap->routeWeight[e] > maxWeight) maxWeight = snap->routeWeight[e];
+        }
+        int numBuckets = maxWeight / delta + 2; // Cyclic buckets, enough to hold every distance still ahead
+        const unsigned long long UNREACHED = (static_cast<unsigned long long>(ROUTE_INF) << 32) | 0xffffffffULL;
+
+        atomic<unsigned long long>* state = new atomic<unsigned long long>[n];
+        for (int i = 0; i < n; i++) state[i].store(UNREACHED, memory_order_relaxed);
+        state[src].store(0xffffffffULL, memory_order_relaxed); // Distance 0, no predecessor
+
+        BucketLists buckets(numBuckets, n + 16);
+        int* frontier = new int[n];   // Nodes to relax in the current phase
+        int* settled = new int[n];    // Nodes settled in the current bucket
+        int* frontierMark = new int[n];
+        int* settledMark = new int[n];
+        for (int i = 0; i < n; i++) frontierMark[i] = settledMark[i] = -1;
+        int** localImproved = new int*[numThreads]; // Nodes each thread lowered in this phase
+        int* localCount = new int[numThreads];
+        int* localCapacity = new int[numThreads];
+        for (int t = 0; t < numThreads; t++) {
+            localCapacity[t] = 1024;
+            localImproved[t] = new int[localCapacity[t]];
+            localCount[t] = 0;
+        }
+
+        int frontierSize = 1;
+        int numSettled = 1;
+        int bucket = 0;
+        int phase = 0;          // Stamp for frontier marks
+        bool heavyPhase = false;
+        bool finished = false;
+        atomic<int> nextChunk(0);
+        frontier[0] = src;
+        settled[0] = src;
+        settledMark[src] = 0;
+        ThreadBarrier barrier(numThreads);
+
+        auto worker = [&](int tid) {
+            const int CHUNK = 64;
+            while (true) {
+                barrier.wait(); // Thread 0 has prepared the phase
+                if (finished) break;
+                int minWeight = heavyPhase ? delta + 1 : 0;
+                int maxWeightAllowed = heavyPhase ? ROUTE_MAX_WEIGHT : delta;
+                while (true) {
+                    int begin = nextChunk.fetch_add(CHUNK);
+                    if (begin >= frontierSize) break;
+                    int end = begin + CHUNK < frontierSize ? begin + CHUNK : frontierSize;
+                    for (int i = begin; i < end; i++) {
+                        int u = frontier[i];
+                        Distance du = static_cast<Distance>(state[u].load(memory_order_relaxed) >> 32);
+                        for (int e = snap->firstOut[u]; e < snap->firstOut[u + 1]; e++) {
+                            int w = snap->routeWeight[e];
+                            if (w < minWeight || w > maxWeightAllowed) continue; // Closed road or the other phase's road
+                            int v = snap->head[e];
+                            unsigned long long candidate = (static_cast<unsigned long long>(du + w) << 32) | static_cast<unsigned int>(e);
+                            unsigned long long current = state[v].load(memory_order_relaxed);
+                            while ((current >> 32) > static_cast<unsigned long long>(du + w)) { // Lower v unless another thread got lower
+                                if (state[v].compare_exchange_weak(current, candidate, memory_order_relaxed)) {
+                                    if (localCount[tid] == localCapacity[tid]) {
+                                        localCapacity[tid] *= 2;
+                                        int* grown = new int[localCapacity[tid]];
+                                        for (int k = 0; k < localCount[tid]; k++) grown[k] = localImproved[tid][k];
+                                        delete[] localImproved[tid];
+                                        localImproved[tid] = grown;
+                                    }
+                                    localImproved[tid][localCount[tid]++] = v;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+                barrier.wait(); // Every thread finished relaxing
+                if (tid != 0) continue;
+
+                /* Thread 0 merges the lowered nodes: the ones still in this
+                 bucket form the next light frontier, the rest go to later buckets*/
+                phase++;
+                frontierSize = 0;
+                for (int t = 0; t < numThreads; t++) {
+                    for (int k = 0; k < localCount[t]; k++) {
+                        int v = localImproved[t][k];
+                        int b = static_cast<int>(static_cast<Distance>(state[v].load(memory_order_relaxed) >> 32) / delta);
+                        if (b != bucket) {
+                            buckets.push(b % numBuckets, v);
+                        } else if (frontierMark[v] != phase) {
+                            frontierMark[v] = phase;
+                            frontier[frontierSize++] = v;
+                            if (settledMark[v] != bucket) {
+                                settledMark[v] = bucket;
+                                settled[numSettled++] = v;
+                            }
+                        }
+                    }
+                    localCount[t] = 0;
+                }
+
+                if (frontierSize == 0 && !heavyPhase) { // Light roads are done, relax the heavy ones once
+                    for (int i = 0; i < numSettled; i++) frontier[i] = settled[i];
+                    frontierSize = numSettled;
+                    heavyPhase = true;
+                } else if (heavyPhase) { // Bucket finished, find the next one with live entries
+                    heavyPhase = false;
+                    numSettled = 0;
+                    while (frontierSize == 0 && buckets.live > 0) {
+                        bucket++;
+                        phase++;
+                        for (int entry = buckets.take(bucket % numBuckets); entry != -1; entry = buckets.entryNext[entry]) {
+                            int v = buckets.entryNode[entry];
+                            buckets.live--;
+                            if (static_cast<int>(static_cast<Distance>(state[v].load(memory_order_relaxed) >> 32) / delta) != bucket) continue; // Stale entry
+                            if (frontierMark[v] == phase) continue;
+                            frontierMark[v] = phase;
+                            frontier[frontierSize++] = v;
+                            settledMark[v] = bucket;
+                            settled[numSettled++] = v;
+                        }
+                    }
+                    finished = frontierSize == 0;
+                }
+                nextChunk.store(0);
+            }
+        };
+
+        thread* pool = new thread[numThreads - 1];
+        for (int t = 1; t < numThreads; t++) pool[t - 1] = thread(worker, t);
+        worker(0); // This thread is worker 0 and merges between phases
+        for (int t = 1; t < numThreads; t++) pool[t - 1].join();
+        delete[] pool;
+
+        for (int i = 0; i < n; i++) {
+            unsigned long long packed = state[i].load(memory_order_relaxed);
+            dist[i] = static_cast<Distance>(packed >> 32);
+            predEdge[i] = static_cast<int>(static_cast<unsigned int>(packed & 0xffffffffULL));
+        }
+
+        delete[] state;
+        delete[] frontier;
+        delete[] settled;
+        delete[] frontierMark;
+        delete[] settledMark;
+        for (int t = 0; t < numThreads; t++) delete[] localImproved[t];
+        delete[] localImproved;
+        delete[] localCount;
+        delete[] localCapacity;
+    }
+
+    /* One-to-all shortest paths with the chosen backend. delta <= 0 picks
+     the average road weight*/
+    void oneToAll(const GraphSnapshot* snap, int src, Distance* dist, int* predEdge, int backend, int delta = 0, int numThreads = 1) {
+        if (backend == BACKEND_DELTA_STEPPING) {
+            snapshotParallelDeltaStepping(snap, src, delta > 0 ? delta : defaultDelta(snap), numThreads, dist, predEdge);
+        } else {
+            snapshotDijkstra(snap, src, dist, predEdge, relaxKernel);
+        }
+    }
+
+    /* Distances from every source to every target, row by row into
+     matrix[s * numTargets + t]. Unreachable pairs get ROUTE_INF*/
+    void distanceMatrix(const GraphSnapshot* snap, const int* sources, int numSources, const int* targets, int numTargets,
+                        Distance* matrix, int backend, int delta = 0, int numThreads = 1) {
+        Distance* dist = new Distance[snap->numNodes > 0 ? snap->numNodes : 1];
+        int* predEdge = new int[snap->numNodes > 0 ? snap->numNodes : 1];
+        if (delta <= 0) delta = defaultDelta(snap);
+        for (int s = 0; s < numSources; s++) {
+            oneToAll(snap, sources[s], dist, predEdge, backend, delta, numThreads);
+            for (int t = 0; t < numTargets; t++) matrix[s * numTargets + t] = dist[targets[t]];
+        }
+        delete[] dist;
+        delete[] predEdge;
+    }
+
+    /* Rows are computed and written MATRIX_BLOCK_ROWS at a time, so a large
+     network never holds the whole matrix. CSV leaves unreachable cells empty*/
+    void displayDistanceMatrix(int backend, int delta, int numThreads, ostream& out = cout, bool csv = false) {
+        const int MATRIX_BLOCK_ROWS = 64;
+        const char separator = csv ? ',' : '\t';
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int n = snap->numNodes;
+        int* all = new int[n > 0 ? n : 1];
+        for (int i = 0; i < n; i++) all[i] = i;
+        Distance* matrix = new Distance[MATRIX_BLOCK_ROWS * (n > 0 ? n : 1)];
+
+        out << "From\\To";
+        for (int t = 0; t < n; t++) out << separator << snap->nodes[t].name;
+        out << '\n';
+        for (int first = 0; first < n; first += MATRIX_BLOCK_ROWS) {
+            int rows = min(MATRIX_BLOCK_ROWS, n - first);
+            distanceMatrix(snap, all + first, rows, all, n, matrix, backend, delta, numThreads);
+            for (int r = 0; r < rows; r++) {
+                out << snap->nodes[first + r].name;
+                for (int t = 0; t < n; t++) {
+                    out << separator;
+                    if (matrix[r * n + t] != ROUTE_INF) out << matrix[r * n + t];
+                    else if (!csv) out << "-";  // Unreachable
+                }
+                out << '\n';
+            }
+        }
+        out.flush();
+        delete[] all;
+        delete[] matrix;
+        unpinSnapshot(readerSlot);
+    }
+
+    /* Time parallel delta-stepping from 1 to 64 threads on a large synthetic
+     network and check every run against Dijkstra's distances*/
+    void benchmarkDeltaStepping(int delta = 0) {
+        const int NUM_SOURCES = 4;
+        GraphSnapshot* snap = buildSyntheticSnapshot(400000, 8, 100, 2024);
+        if (delta <= 0) delta = defaultDelta(snap);
+        int n = snap->numNodes;
+        Distance* reference = new Distance[n * NUM_SOURCES];
+        Distance* dist = new Distance[n];
+        int* predEdge = new int[n];
+        cout << "Synthetic network: " << n << " nodes, " << snap->numEdges << " roads, delta " << delta
+             << ", " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+        auto start = chrono::high_resolution_clock::now();
+        for (int s = 0; s < NUM_SOURCES; s++) {
+            snapshotDijkstra(snap, s * (n / NUM_SOURCES), reference + s * n, predEdge, relaxKernel);
+        }
+        chrono::duration<double, milli> dijkstraTime = chrono::high_resolution_clock::now() - start;
+        cout << "  Dijkstra            " << dijkstraTime.count() << " ms" << endl;
+
+        double oneThreadTime = 0;
+        bool allMatch = true;
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            bool match = true;
+            start = chrono::high_resolution_clock::now();
+            for (int s = 0; s < NUM_SOURCES; s++) {
+                snapshotParallelDeltaStepping(snap, s * (n / NUM_SOURCES), delta, threads, dist, predEdge);
+                if (memcmp(dist, reference + s * n, n * sizeof(Distance)) != 0) match = false;
+            }
+            chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+            if (threads == 1) oneThreadTime = elapsed.count();
+            cout << "  Delta-stepping x" << threads << (threads < 10 ? "  " : " ") << "  " << elapsed.count() << " ms";
+            if (elapsed.count() > 0) cout << " (speedup x" << oneThreadTime / elapsed.count() << ")";
+            cout << (match ? ", same distances as Dijkstra" : ", DISTANCES DIFFER") << endl;
+            allMatch = allMatch && match;
+        }
+        cout << (allMatch ? "All thread counts agree with Dijkstra." : "Delta-stepping disagrees with Dijkstra!") << endl;
+
+        delete[] reference;
+        delete[] dist;
+        delete[] predEdge;
+        delete snap;
+    }
+
+    /* Overlay of the pinned snapshot, valid until the reader unpins. The
+     published one is used as is when it matches; otherwise a new one is
+     customized under writerMutex and published. Closing or reopening roads
+     keeps the partition (a copy is customized again); other edits build a
+     new one. A reader pinned on an older version than the published overlay
+     gets a copy of its own, ownCopy tells it to delete it*/
+    RegionOverlay* currentOverlay(const GraphSnapshot* snap, bool& ownCopy) {
+        const int LEAF_SIZE = 128;
+        const int LEVELS = 3;
+        ownCopy = false;
+        RegionOverlay* published = overlay.load();
+        if (published != nullptr && published->version == snap->version) return published;
+
+        lock_guard<recursive_mutex> lock(writerMutex); // Only writers replace the overlay, so published stays valid
+        published = overlay.load();
+        if (published != nullptr && published->version == snap->version) return published; // Built by another reader meanwhile
+        RegionOverlay* regions = published != nullptr && published->sameRoads(snap) ? published->clone() : new RegionOverlay(snap, LEAF_SIZE, LEVELS);
+        regions->customize(snap->routeWeight, static_cast<int>(thread::hardware_concurrency()));
+        regions->version = snap->version;
+        if (published != nullptr && published->version > snap->version) ownCopy = true; // Don't replace a newer one
+        else publishOverlay(regions);
+        return regions;
+    }
+
+    void overlayRoute(const string& fromName, const string& toName) {
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int from = snapshotNodeIndex(snap, fromName);
+        int to = snapshotNodeIndex(snap, toName);
+        if (from == -1 || to == -1) {
+            cout << "One or both Nodes not found!" << endl;
+            unpinSnapshot(readerSlot);
+            return;
+        }
+        bool ownCopy;
+        RegionOverlay* regions = currentOverlay(snap, ownCopy);
+        OverlaySearch search(snap->numNodes);
+        Distance distance = regions->query(from, to, search);
+        if (distance == ROUTE_INF) cout << "Node is Unreachable" << endl;
+        else cout << "Shortest Distance over the region overlay: " << distance << endl;
+        cout << "(" << regions->numCells[1] << " cells on level 1, " << regions->numLevels << " levels)" << endl;
+        if (ownCopy) delete regions;
+        unpinSnapshot(readerSlot);
+    }
+
+    /* Sets new travel times for a batch of roads (indices into streets) and
+     publishes them as one version. When the overlay was current, a copy of
+     it gets only the cells holding the changed roads customized again and
+     is then published, so queries on the old one are never disturbed and
+     new travel times can reach routing every few seconds. Returns the
+     number of roads whose weight changed*/
+    int updateRoadWeights(const int* roads, const int* weights, int count) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        long long before = graphVersion.load();
+        int* changed = new int[count > 0 ? count : 1];
+        int numChanged = 0;
+        for (int i = 0; i < count; i++) {
+            if (roads[i] < 0 || roads[i] >= numEdges || weights[i] < 0 || weights[i] > ROUTE_MAX_WEIGHT) continue; // Doesn't fit a Weight
+            if (streets[roads[i]].weight == weights[i]) continue;
+            streets[roads[i]].weight = static_cast<Weight>(weights[i]);
+            changed[numChanged++] = roads[i];
+        }
+        if (numChanged == 0) {
+            delete[] changed;
+            return 0;
+        }
+        publishSnapshot();
+
+        GraphSnapshot* snap = currentSnapshot.load(); // Safe to read, writers hold writerMutex
+        RegionOverlay* published = overlay.load(); // Only writers replace it
+        if (published != nullptr && published->version == before && snap->version == before + 1) {
+            int* streetSlot = new int[snap->numEdges > 0 ? snap->numEdges : 1];
+            for (int e = 0; e < snap->numEdges; e++) streetSlot[snap->edgeId[e]] = e;
+            for (int i = 0; i < numChanged; i++) changed[i] = streetSlot[changed[i]];
+            RegionOverlay* regions = published->clone();
+            regions->updateWeights(snap->routeWeight, changed, numChanged, static_cast<int>(thread::hardware_concurrency()));
+            regions->version = snap->version;
+            publishOverlay(regions);
+            delete[] streetSlot;
+        } // Otherwise the next overlay query customizes or rebuilds it
+        delete[] changed;
+        return numChanged;
+    }
+
+    void loadWeightUpdates(const string& fileName) { // From,To,TravelTime lines, e.g. measured congestion
+        ifstream file(fileName);
+        if (!file.is_open()) {
+            cout << "Could not open " << fileName << endl;
+            return;
+        }
+        string header, from, to;
+        int weight;
+        getline(file, header); // Skip the header row
+
+        int count = 0, capacity = 16, unknown = 0;
+        int* roads = new int[capacity];
+        int* weights = new int[capacity];
+        while (getline(file, from, ',') && getline(file, to, ',') && file >> weight) {
+            file.ignore(__LONG_MAX__, '\n');
+            if (from.empty() || to.empty()) continue;
+            int index = findEdgeIndex(from, to);
+            if (index == -1) {
+                unknown++;
+                continue;
+            }
+            if (count == capacity) { // Double the batch
+                capacity *= 2;
+                int* newRoads = new int[capacity];
+                int* newWeights = new int[capacity];
+                for (int i = 0; i < count; i++) {
+                    newRoads[i] = roads[i];
+                    newWeights[i] = weights[i];
+                }
+                delete[] roads;
+                delete[] weights;
+                roads = newRoads;
+                weights = newWeights;
+            }
+            roads[count] = index;
+            weights[count++] = weight;
+        }
+        file.close();
+
+        auto start = chrono::high_resolution_clock::now();
+        int changed = updateRoadWeights(roads, weights, count);
+        chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+        cout << "Read " << count << " updates, " << changed << " roads changed";
+        if (unknown > 0) cout << ", " << unknown << " unknown roads skipped";
+        cout << " (" << elapsed.count() << " ms)" << endl;
+        cout << "Routing now uses version " << getGraphVersion() << endl;
+        delete[] roads;
+        delete[] weights;
+    }
+
+    /* Customizes the overlay of a synthetic network once, then applies
+     batches of random weight changes of growing size and compares the
+     incremental customization with a full one and with Dijkstra*/
+    void benchmarkWeightUpdates(int numThreads) {
+        const int NUM_NODES = 200000;
+        const int NUM_QUERIES = 50;
+        if (numThreads < 1) numThreads = 1;
+        if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+        GraphSnapshot* snap = buildSyntheticSnapshot(NUM_NODES, 4, 100, 4242, true);
+        int n = snap->numNodes;
+        cout << "Synthetic network: " << n << " nodes, " << snap->numEdges << " roads" << endl;
+
+        auto start = chrono::high_resolution_clock::now();
+        RegionOverlay regions(snap, 128, 3);
+        chrono::duration<double, milli> partitionTime = chrono::high_resolution_clock::now() - start;
+        start = chrono::high_resolution_clock::now();
+        regions.customize(snap->routeWeight, numThreads);
+        chrono::duration<double, milli> fullTime = chrono::high_resolution_clock::now() - start;
+        cout << "  Partition " << partitionTime.count() << " ms, full customization on " << numThreads << " threads "
+             << fullTime.count() << " ms" << endl;
+
+        XorShiftRandom random(11);
+        Distance* dist = new Distance[n];
+        int* predEdge = new int[n];
+        OverlaySearch search(n);
+        bool allMatch = true;
+        int batchSizes[] = {1, 10, 100, 1000, 10000};
+        for (int b = 0; b < 5; b++) {
+            int size = batchSizes[b];
+            int* slots = new int[size];
+            for (int i = 0; i < size; i++) { // Congestion makes roads up to three times slower, or clears it again
+                slots[i] = random.below(snap->numEdges);
+                snap->routeWeight[slots[i]] = static_cast<Weight>(snap->weight[slots[i]] * (1.0 + 2.0 * random.uniform()));
+            }
+            start = chrono::high_resolution_clock::now();
+            int redone = regions.updateWeights(snap->routeWeight, slots, size, numThreads);
+            chrono::duration<double, milli> updateTime = chrono::high_resolution_clock::now() - start;
+
+            bool match = true;
+            for (int q = 0; q < NUM_QUERIES; q++) {
+                int from = random.below(n), to = random.below(n);
+                snapshotDijkstra(snap, from, dist, predEdge, relaxKernel, to);
+                if (regions.query(from, to, search) != dist[to]) match = false;
+            }
+            if (!match) allMatch = false;
+            cout << "  Batch of " << size << " roads: " << redone << " cells customized again in "
+                 << updateTime.count() << " ms" << (match ? "" : ", DISTANCES DIFFER") << endl;
+            delete[] slots;
+        }
+        cout << (allMatch ? "All distances agree with Dijkstra." : "Overlay disagrees with Dijkstra!") << endl;
+
+        delete[] dist;
+        delete[] predEdge;
+        delete snap;
+    }
+
+    /* Times repeated route queries on a synthetic network with and without a
+     route cache. The queries pick from a few hundred origin-destination pairs,
+     popular pairs more often, and run on numThreads workers sharing one cache.
+     The second half looks the routes up under the next snapshot version, as
+     after an edit, so every route has to be found again. Cached distances are
+     checked against the searches*/
+    void benchmarkRouteCache(int numThreads) {
+        const int NUM_NODES = 20000;
+        const int NUM_PAIRS = 512;
+        const int NUM_QUERIES = 8000;
+        if (numThreads < 1) numThreads = 1;
+        if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+        GraphSnapshot* snap = buildSyntheticSnapshot(NUM_NODES, 4, 30, 77);
+        int n = snap->numNodes;
+        cout << "Synthetic network: " << n << " nodes, " << snap->numEdges << " roads, " << NUM_QUERIES << " queries over "
+             << NUM_PAIRS << " pairs on " << numThreads << " threads" << endl;
+
+        XorShiftRandom random(23);
+        int* pairFrom = new int[NUM_PAIRS];
+        int* pairTo = new int[NUM_PAIRS];
+        for (int p = 0; p < NUM_PAIRS; p++) {
+            pairFrom[p] = random.below(n);
+            pairTo[p] = random.below(n);
+        }
+        int* query = new int[NUM_QUERIES];
+        for (int q = 0; q < NUM_QUERIES; q++) query[q] = random.below(random.below(NUM_PAIRS) + 1); // Low pairs are popular
+        long long* searched = new long long[NUM_QUERIES];
+        long long* cachedDistance = new long long[NUM_QUERIES];
+        RelaxKernel kernel = selectRelaxKernel();
+        RouteCache cache(ROUTE_CACHE_ENTRIES, ROUTE_CACHE_SHARDS);
+
+        auto run = [&](bool useCache, long long* result) { // Returns milliseconds
+            auto start = chrono::high_resolution_clock::now();
+            for (int half = 0; half < 2; half++) {
+                long long version = snap->version + half; // As if an edit was published halfway, every cached route is then of an older version
+                atomic<int> next(half * NUM_QUERIES / 2);
+                int end = (half + 1) * NUM_QUERIES / 2;
+                auto worker = [&]() {
+                    Distance* dist = new Distance[n];
+                    int* predEdge = new int[n];
+                    for (int q = next.fetch_add(1); q < end; q = next.fetch_add(1)) {
+                        int src = pairFrom[query[q]], dst = pairTo[query[q]];
+                        Route route;
+                        Distance d;
+                        if (useCache) {
+                            result[q] = cachedShortestRoute(cache, snap, version, src, dst, dist, predEdge, kernel, route, d) ? d : -1;
+                        } else {
+                            snapshotDijkstra(snap, src, dist, predEdge, kernel, dst);
+                            result[q] = dist[dst] == ROUTE_INF ? -1 : dist[dst];
+                            if (result[q] != -1) route = routeFromPredecessors(snap, src, dst, predEdge);
+                        }
+                    }
+                    delete[] dist;
+                    delete[] predEdge;
+                };
+                thread* pool = new thread[numThreads];
+                for (int t = 1; t < numThreads; t++) pool[t] = thread(worker);
+                worker();
+                for (int t = 1; t < numThreads; t++) pool[t].join();
+                delete[] pool;
+            }
+            chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+            return elapsed.count();
+        };
+
+        double searchTime = run(false, searched);
+        double cacheTime = run(true, cachedDistance);
+        int mismatches = 0;
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            if (searched[q] != cachedDistance[q]) mismatches++;
+        }
+        long long hits, misses, stale, evictions, bytes;
+        int entries;
+        cache.summary(hits, misses, stale, evictions, entries, bytes);
+        cout << "  Without cache " << searchTime << " ms, with cache " << cacheTime << " ms ("
+             << (cacheTime > 0 ? searchTime / cacheTime : 0.0) << "x)" << endl;
+        cout << "  " << hits << " hits, " << misses << " misses (" << stale << " on the older version), hit rate "
+             << 100.0 * hits / (hits + misses) << "%, " << entries << " routes held in " << bytes / 1024 << " KB" << endl;
+        cout << (mismatches == 0 ? "All distances match" : "MISMATCH") << " (" << mismatches << " differing queries)" << endl;
+
+        delete[] pairFrom;
+        delete[] pairTo;
+        delete[] query;
+        delete[] searched;
+        delete[] cachedDistance;
+        delete snap;
+    }
+
+    /* Partitions a synthetic network whose nodes are stored in random order,
+     then compares plain Dijkstra on that order, Dijkstra on the renumbered
+     graph and multi-level overlay queries on random pairs*/
+    void benchmarkRegionOverlay(int numThreads) {
+        const int NUM_NODES = 200000;
+        const int NUM_QUERIES = 200;
+        if (numThreads < 1) numThreads = 1;
+        if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+        GraphSnapshot* snap = buildSyntheticSnapshot(NUM_NODES, 4, 100, 4242, true);
+        int n = snap->numNodes;
+        cout << "Synthetic network: " << n << " nodes, " << snap->numEdges << " roads, stored in random order" << endl;
+
+        auto start = chrono::high_resolution_clock::now();
+        RegionOverlay regions(snap, 128, 3);
+        chrono::duration<double, milli> partitionTime = chrono::high_resolution_clock::now() - start;
+        start = chrono::high_resolution_clock::now();
+        regions.customize(snap->routeWeight, numThreads);
+        chrono::duration<double, milli> customizeTime = chrono::high_resolution_clock::now() - start;
+        cout << "  Partition " << partitionTime.count() << " ms, customization on " << numThreads << " threads "
+             << customizeTime.count() << " ms, " << regions.cliqueEntries() << " clique entries" << endl;
+        for (int l = 1; l <= regions.numLevels; l++) {
+            cout << "  Level " << l << ": " << regions.numCells[l] << " cells, "
+                 << regions.boundaryStart[l][regions.numCells[l]] << " boundary nodes" << endl;
+        }
+
+        long long spanBefore = 0, spanAfter = 0; // How far apart in memory the two ends of a road are
+        for (int e = 0; e < snap->numEdges; e++) spanBefore += abs(snap->tail[e] - snap->head[e]);
+        for (int u = 0; u < n; u++) {
+            for (int a = regions.firstOut[u]; a < regions.firstOut[u + 1]; a++) spanAfter += abs(u - regions.head[a]);
+        }
+        cout << "  Mean node distance of a road: " << static_cast<double>(spanBefore) / snap->numEdges << " before, "
+             << static_cast<double>(spanAfter) / snap->numEdges << " after renumbering" << endl;
+
+        XorShiftRandom random(7);
+        int* from = new int[NUM_QUERIES];
+        int* to = new int[NUM_QUERIES];
+        Distance* reference = new Distance[NUM_QUERIES];
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            from[q] = random.below(n);
+            to[q] = random.below(n);
+        }
+        Distance* dist = new Distance[n];
+        int* predEdge = new int[n];
+        start = chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            snapshotDijkstra(snap, from[q], dist, predEdge, relaxKernel, to[q]);
+            reference[q] = dist[to[q]];
+        }
+        chrono::duration<double, milli> dijkstraTime = chrono::high_resolution_clock::now() - start;
+
+        OverlaySearch search(n);
+        bool renumberedMatch = true, overlayMatch = true;
+        start = chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            int target = regions.oldToNew[to[q]];
+            regions.search(regions.oldToNew[from[q]], target, 0, 0, search); // Level 0: plain Dijkstra, renumbered
+            if (search.get(target) != reference[q]) renumberedMatch = false;
+        }
+        chrono::duration<double, milli> renumberedTime = chrono::high_resolution_clock::now() - start;
+        start = chrono::high_resolution_clock::now();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            if (regions.query(from[q], to[q], search) != reference[q]) overlayMatch = false;
+        }
+        chrono::duration<double, milli> overlayTime = chrono::high_resolution_clock::now() - start;
+
+        cout << "  " << NUM_QUERIES << " random queries:" << endl;
+        cout << "    Dijkstra, file order        " << dijkstraTime.count() / NUM_QUERIES << " ms/query" << endl;
+        cout << "    Dijkstra, renumbered        " << renumberedTime.count() / NUM_QUERIES << " ms/query"
+             << (renumberedMatch ? "" : ", DISTANCES DIFFER") << endl;
+        cout << "    Multi-level overlay         " << overlayTime.count() / NUM_QUERIES << " ms/query"
+             << (overlayMatch ? "" : ", DISTANCES DIFFER") << endl;
+        cout << (renumberedMatch && overlayMatch ? "All distances agree with Dijkstra." : "Overlay disagrees with Dijkstra!") << endl;
+
+        delete[] from;
+        delete[] to;
+        delete[] reference;
+        delete[] dist;
+        delete[] predEdge;
+        delete snap;
+    }
+
+    void displayCongestion() {
+        /* Loop through each road 
+        and display the vehicle count*/
+        for (int i = 0; i < numEdges; i++) {
+            const string& fromName = intersections[streets[i].from].name;
+            const string& toName = intersections[streets[i].to].name;
+            int index = hashFunction(fromName, toName);
+            cout << "Road " << fromName << "-" << toName << ": "
+                 << vehicleCounts[index] << " vehicles";
+            // Check if the road is congested, its capacity is right here
+            if (vehicleCounts[index] >= streets[i].capacity) {
+                cout << " (Congested)"; // Mark as congested if true
+            }
+            cout << endl;
+        }
+    }
+
+    void blockRoad(const string& fromName, const string& toName) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        int index = findEdgeIndex(fromName, toName); // Find the index of the start and end nodes
+        if (index != -1) {
+            streets[index].isActive = false; // Set road as inactive
+            publishSnapshot();
+            cout << "Road from " << fromName << " to " << toName << " has been closed." << endl;
+        } else {
+            cout << "Edge not found." << endl; // If no such road, show error
+        }
+    }
+
+    void reopenRoad(const string& fromName, const string& toName) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        int index = findEdgeIndex(fromName, toName); // Find the index of the road to reopen
+        if (index != -1) {
+            streets[index].isActive = true; // Set road as active
+            publishSnapshot();
+            cout << "Road from " << fromName << " to " << toName << " has been reopened." << endl;
+        } else {
+            cout << "Edge not found." << endl; // If no such road, show error
+        }
+    }
+
+    /* Closes or reopens the road between two intersections given by index,
+     without printing, for the routing service. Returns false when there is
+     no such road*/
+    bool setRoadActive(int from, int to, bool active) {
+        lock_guard<recursive_mutex> lock(writerMutex);
+        if (from < 0 || from >= numNodes || to < 0 || to >= numNodes) return false;
+        int index = findEdgeIndex(intersections[from].name, intersections[to].name);
+        if (index == -1) return false;
+        if (streets[index].isActive != active) {
+            streets[index].isActive = active;
+            publishSnapshot();
+        }
+        return true;
+    }
+
+    bool isEdgeActive(const string& fromName, const string& toName) {
+        int index = findEdgeIndex(fromName, toName);  // Find the index of the road to reopen
+        if (index != -1) {
+            return streets[index].isActive; // Return true if the road is active
+        }
+        return false; // Return false if no such road is found.
+    }
+};
+
+class Vehicles : public Graph {
+private:
+    FleetStore fleet;
+
+public:
+    Vehicles() : Graph() {}
+
+    void nodeRemoved(int index) override { // Keep the fleet's node indices in step with the shifted intersections
+        for (int i = 0; i < fleet.size; i++) {
+            if (fleet.origin[i] == index || fleet.destination[i] == index) {
+                fleet.origin[i] = fleet.destination[i] = -1; // Its trip no longer exists
+                continue;
+            }
+            if (fleet.origin[i] > index) fleet.origin[i]--;
+            if (fleet.destination[i] > index) fleet.destination[i]--;
+        }
+    }
+
+    int getnumVehicles() {
+        return fleet.size;
+    }
+
+    int findVehicle(const string& id) { // Index of the vehicle with this ID, or -1
+        return fleet.find(id);
+    }
+       
+    void createVehicles(const string& name, string& from_node, string& to_node, string priorityLevel) {  // Creating a new gari
+        int Start = findNodeIndex(from_node);
+        int End = findNodeIndex(to_node);
+        /* If either start or end node is not found,
+         show an error message*/
+        if (Start == -1 || End == -1) { 
+            cout << "One or both Nodes not found!" << endl;
+            return;
+        }
+
+        if (fleet.add(name, Start, End, FleetStore::parsePriority(priorityLevel)) == -1) {
+            cout << "Vehicle " << name << " already exists!" << endl;
+        }
+    }
+
+    void displayVehicle(const string& id) { // Look a vehicle up by its ID
+        int i = fleet.find(id);
+        if (i == -1) {
+            cout << "Vehicle not found!" << endl;
+            return;
+        }
+        cout << "ID: " << fleet.idOf(i);
+        if (fleet.origin[i] == -1) {
+            cout << ", its start or end intersection was deleted";
+        } else {
+            cout << ", Start: " << getNode(fleet.origin[i])->name << ", End: " << getNode(fleet.destination[i])->name;
+        }
+        cout << ", Priority: " << fleet.priorityName(i) << endl;
+    }
+
+        void Input_Vehicle() {  // Create a new vehicle and set its properties
+        string id, Start, End, p_level;
+        while (true) {
+            cout << "Enter Vehicle ID, Start Intersection, End Intersection and Priority_Level : "; 
+            cin >> id >> Start >> End >> p_level;   // Create a new vehicle and set its properties
+            if (id == "-1") {
+                break; 
+            }
+            createVehicles(id, Start, End, p_level); // Default priority level is "Low"
+            if(p_level != "High"){
+                ofstream file("vehicles.csv", std::ios::app);
+                file << id << "," << Start << "," << End << endl; 
+                file.close();
+            }
+            else{
+                ofstream file1("emergency_vehicles.csv", std::ios::app);
+                file1 << id << "," << Start << "," << End << "," << p_level << endl; 
+                file1.close();
+            }
+            
+        }
+    }
+    void calcaulate_route() {   // Calculate the shortest route for each vehicle
+        Distance distance;
+        for (int i = 0; i < fleet.size; i++) {
+            cout << "Vehicle with id " << fleet.idOf(i) << endl;
+            if (fleet.origin[i] == -1) {
+                cout << "Node is Unreachable" << endl;
+                continue;
+            }
+
+            /*Use Dijkstra's algorithm
+             to find the path*/ 
+            Route path = dijkstra(getNode(fleet.origin[i])->name, getNode(fleet.destination[i])->name, distance);
+
+            if (!path.found()) {
+                cout << "Node is Unreachable" << endl;
+            } 
+            else {     // Display the path and the distance
+                cout << "Path: ";
+                displayRoute(path);
+                cout << endl;
+                cout << "Shortest Distance: " << distance << endl;
+                cout << endl;
+            }
+        }
+    }
+
+    /* Shortest route of every vehicle, written to out in fleet order for batch
+     runs. The fleet is routed ROUTE_BLOCK vehicles at a time: the workers take
+     vehicles of the block from a shared counter, each with its own search
+     arrays, and the block is written before the next one starts. CSV rows are
+     VehicleID,Start,End,Distance,Path with the path as A;B;C, left empty
+     (and the distance -1) when the destination can't be reached*/
+    void routeAllVehicles(ostream& out, bool csv, int numThreads) {
+        const int ROUTE_BLOCK = 4096;
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int n = snap->numNodes;
+        int* snapshotNode = snapshotNodeMap(snap); // Fleet trips use the live numbering
+        Route* routes = new Route[ROUTE_BLOCK];
+        long long* distance = new long long[ROUTE_BLOCK]; // -1 when unreachable, wide enough for any Distance
+        RelaxKernel kernel = selectRelaxKernel();
+        if (numThreads < 1) numThreads = 1;
+
+        if (csv) out << "VehicleID,Start,End,Distance,Path\n";
+        for (int first = 0; first < fleet.size; first += ROUTE_BLOCK) {
+            int count = min(ROUTE_BLOCK, fleet.size - first);
+            atomic<int> next(0);
+            auto worker = [&]() {
+                Distance* dist = new Distance[n > 0 ? n : 1];
+                int* predEdge = new int[n > 0 ? n : 1];
+                for (int k = next.fetch_add(1); k < count; k = next.fetch_add(1)) {
+                    routes[k] = Route();
+                    distance[k] = -1;
+                    if (fleet.origin[first + k] == -1) continue; // Its trip was removed with an intersection
+                    int src = snapshotNode[fleet.origin[first + k]], dst = snapshotNode[fleet.destination[first + k]];
+                    if (src == -1 || dst == -1) continue;
+                    Distance d;
+                    if (cachedShortestRoute(getRouteCache(), snap, snap->version, src, dst, dist, predEdge, kernel, routes[k], d)) distance[k] = d; // Vehicles often share a trip
+                }
+                delete[] dist;
+                delete[] predEdge;
+            };
+            int workers = min(numThreads, count);
+            thread* pool = new thread[workers];
+            for (int t = 1; t < workers; t++) pool[t] = thread(worker);
+            worker();
+            for (int t = 1; t < workers; t++) pool[t].join();
+            delete[] pool;
+
+            for (int k = 0; k < count; k++) {
+                int i = first + k;
+                if (csv) {
+                    out << fleet.idOf(i) << ',';
+                    if (fleet.origin[i] != -1) out << getNode(fleet.origin[i])->name << ',' << getNode(fleet.destination[i])->name;
+                    else out << ',';
+                    out << ',' << distance[k] << ',';
+                    if (distance[k] != -1) displayRoute(routes[k], out, ";");
+                    out << '\n';
+                } else { // Same layout as menu option 9
+                    out << "Vehicle with id " << fleet.idOf(i) << '\n';
+                    if (distance[k] == -1) {
+                        out << "Node is Unreachable" << '\n';
+                        continue;
+                    }
+                    out << "Path: ";
+                    displayRoute(routes[k], out);
+                    out << '\n' << "Shortest Distance: " << distance[k] << "\n\n";
+                }
+            }
+            out.flush();
+        }
+        delete[] routes;
+        delete[] distance;
+        delete[] snapshotNode;
+        unpinSnapshot(readerSlot);
+    }
+
+    void vehicles_csv(const string& vehicleFile = "vehicles.csv", const string& emergencyFile = "emergency_vehicles.csv") {   // Read vehicle data from CSV files
+        ifstream file(vehicleFile);
+        string header;
+        getline(file, header); // Skip the header row, newline included so the first ID is clean
+        string id, start, end;
+        string priorityLevel;
+
+        while (file.good()) {  // Process general vehicle data
+            getline(file, id, ',');
+            getline(file, start, ',');
+            file >> end;
+            priorityLevel = "Low";
+            file.ignore(__LONG_MAX__, '\n');
+            if (!start.empty() && !end.empty() && !id.empty()) {
+                createVehicles(id, start, end, priorityLevel);
+            }
+        }
+        file.close();
+
+        ifstream file1(emergencyFile);
+        getline(file1, header);
+
+        while (file1.good()) {  // Process emergency vehicle data
+            getline(file1, id, ',');
+            getline(file1, start, ',');
+            getline(file1, end, ',');
+            file1 >> priorityLevel;
+            file1.ignore(__LONG_MAX__, '\n');
+            if (!start.empty() && !end.empty() && !id.empty() && !priorityLevel.empty()) {
+                createVehicles(id, start, end, priorityLevel);
+            }
+        }
+        file1.close();
+    }
+
+    void displayVehicles() { // Display the list of all vehicles
+        if (fleet.size == 0) {
+            cout << "No vehicles available." << endl;
+            return;
+        }
+        cout << "Vehicles in the system:" << endl;
+        for (int i = 0; i < fleet.size; i++) {  // Loop through each vehicle and print its details
+            if (fleet.origin[i] == -1) continue; // Its trip was removed with an intersection
+            cout << "ID: " << fleet.idOf(i) << ", Start: " << getNode(fleet.origin[i])->name
+                << ", End: " << getNode(fleet.destination[i])->name << ", Priority: " << fleet.priorityName(i) << endl;
+        }
+    }
+    /*Calculate the total travel time for a vehicle
+     along a route, one array read per road. -1 if the
+     roads changed since the route was found*/ 
+    int calculate_travel_time(const Route& path) {
+        int total_time = 0;
+        int departure_time = 0;
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        if (!path.found() || path.version != snap->version) {
+            unpinSnapshot(readerSlot);
+            return -1;
+        }
+
+        for (int index = 0; index < path.length; index++) {  // Traverse each segment of the path
+            int edge = path.edges[index];
+            int travel_time = snap->weight[edge];
+            int arrival_time = departure_time + travel_time;
+
+            if (!is_light_green(snap, edge, arrival_time)) { // Check traffic light condition 
+                int wait_time = calculate_wait_time(snap, edge, arrival_time);  //calculate waiting time
+                total_time += travel_time + wait_time;
+                departure_time = arrival_time + wait_time;
+            } 
+            else {
+                total_time += travel_time;
+                departure_time = arrival_time;
+            }
+        }
+        unpinSnapshot(readerSlot);
+        return total_time;
+    }
+
+    /* Total time the fleet spends waiting at red lights under one timing plan.
+     A plan is given as wait tables laid out like the snapshot's (see
+     fillSignalWaitTable), and the routes are flattened into hops beforehand:
+     hopTable is where the table of the hop's phase starts, so an evaluation is
+     one pass with one lookup per hop. nodeWait, if given, receives the waiting
+     time per intersection*/
+    long long evaluateSignalPlan(const int* hopStart, const int* hopNode, const int* hopTable, const int* hopWeight, int numRoutes,
+                                 const int* cycle, const int* waitTable, long long* nodeWait) {
+        long long total_wait = 0;
+        for (int r = 0; r < numRoutes; r++) {
+            long long time = 0;
+            for (int h = hopStart[r]; h < hopStart[r + 1]; h++) {
+                int node = hopNode[h];
+                time += hopWeight[h]; // Arrival at the next intersection
+                int wait = waitTable[hopTable[h] + static_cast<int>(time % cycle[node])];
+                time += wait;
+                total_wait += wait;
+                if (nodeWait != nullptr) nodeWait[node] += wait;
+            }
+        }
+        return total_wait;
+    }
+
+    /* Search green splits and offsets that minimize the total waiting time of
+     the fleet. Cycle lengths stay fixed. A single phase signal may move its green
+     between MIN_GREEN and cycle - MIN_RED so cross traffic still gets its turn;
+     a multi phase signal moves green time between neighbouring phases. Steepest
+     descent: each round evaluates every single-intersection change in parallel
+     and applies the best one, halving the step when nothing improves. The result
+     is written as a new timings file*/
+    void optimizeSignalTimings(const string& outputFile = "optimized_signal_timings.csv") {
+        const int MIN_GREEN = 10;
+        const int MIN_RED = 10;
+        const int MAX_ROUNDS = 1000;
+        int n = getnumNodes();
+        if (n == 0 || fleet.size == 0) {
+            cout << "Nothing to optimize, add intersections and vehicles first." << endl;
+            return;
+        }
+
+        int* cycle = new int[n];
+        int* offset = new int[n];
+        int* phases = new int[n];
+        int* greens = new int[n * MAX_PHASES];
+        int* tableStart = new int[n]; // Wait tables of intersection i start at waitTable[tableStart[i]]
+        int tableSize = 0;
+        for (int i = 0; i < n; i++) {
+            Nodes* node = getNode(i);
+            cycle[i] = node->cycle;
+            offset[i] = ((node->offset % cycle[i]) + cycle[i]) % cycle[i];
+            phases[i] = node->numPhases;
+            for (int p = 0; p < MAX_PHASES; p++) greens[i * MAX_PHASES + p] = p < node->numPhases ? node->phaseGreen[p] : 0;
+            tableStart[i] = tableSize;
+            tableSize += phases[i] * cycle[i];
+        }
+        int* waitTable = new int[tableSize > 0 ? tableSize : 1]; // The current plan
+        auto fillTable = [&](int* table, int i, int nodeOffset, const int* nodeGreens) {
+            fillSignalWaitTable(table + tableStart[i], cycle[i], nodeOffset, nodeGreens, phases[i]);
+        };
+        for (int i = 0; i < n; i++) fillTable(waitTable, i, offset[i], greens + i * MAX_PHASES);
+
+        Route* routes = new Route[fleet.size];
+        assignVehicleRoutes(routes);
+
+        int totalHops = 0;
+        for (int i = 0; i < fleet.size; i++) totalHops += routes[i].length;
+        int* hopStart = new int[fleet.size + 1]; // Hops of route r are hopStart[r] .. hopStart[r + 1] - 1
+        int* hopNode = new int[totalHops > 0 ? totalHops : 1];
+        int* hopTable = new int[totalHops > 0 ? totalHops : 1];
+        int* hopWeight = new int[totalHops > 0 ? totalHops : 1];
+        int numRoutes = 0, hops = 0;
+        bool* used = new bool[n]; // Intersections some vehicle waits at
+        for (int i = 0; i < n; i++) used[i] = false;
+
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        for (int i = 0; i < fleet.size; i++) { // Flatten the routes of the vehicles that obey signals
+            if (!routes[i].found() || routes[i].version != snap->version || fleet.priority[i] == PRIORITY_HIGH) continue;
+            hopStart[numRoutes++] = hops;
+            for (int j = 0; j < routes[i].length; j++) {
+                int edge = routes[i].edges[j];
+                int node = snap->head[edge];
+                hopNode[hops] = node;
+                hopTable[hops] = tableStart[node] + snap->approachPhase[edge] * cycle[node];
+                hopWeight[hops++] = snap->weight[edge];
+                used[node] = true;
+            }
+        }
+        hopStart[numRoutes] = hops;
+        unpinSnapshot(readerSlot);
+        delete[] routes;
+
+        long long* waitBefore = new long long[n];
+        long long* waitAfter = new long long[n];
+        for (int i = 0; i < n; i++) waitBefore[i] = waitAfter[i] = 0;
+        long long baseline = evaluateSignalPlan(hopStart, hopNode, hopTable, hopWeight, numRoutes, cycle, waitTable, waitBefore);
+        long long current = baseline;
+
+        /* Candidate c changes one intersection: its offset +/- step, or green
+         time moved between phases. The workers are started once and each keeps
+         its own copy of the plan's wait tables. Every round they refill the
+         intersection the last round changed, then score a share of the
+         candidates by rewriting only the candidate's intersection and putting
+         it back afterwards. Rounds start and end at a barrier*/
+        int maxCandidates = (MAX_PHASES + 2) * n;
+        int* candNode = new int[maxCandidates];
+        int* candOffset = new int[maxCandidates];
+        int* candGreens = new int[maxCandidates * MAX_PHASES];
+        long long* candScore = new long long[maxCandidates];
+        int numCandidates = 0;
+        int changedNode = -1; // Intersection the last round changed, -1 if none
+        bool finished = false;
+        int workers = static_cast<int>(thread::hardware_concurrency());
+        if (workers < 1) workers = 1;
+        if (workers > maxCandidates) workers = maxCandidates;
+        ThreadBarrier roundBarrier(workers + 1); // The workers and this thread
+
+        thread* pool = new thread[workers];
+        for (int w = 0; w < workers; w++) {
+            pool[w] = thread([&, w]() {
+                int* myTable = new int[tableSize > 0 ? tableSize : 1];
+                memcpy(myTable, waitTable, tableSize * sizeof(int));
+                while (true) {
+                    roundBarrier.wait(); // Round starts
+                    if (finished) break;
+                    if (changedNode != -1) fillTable(myTable, changedNode, offset[changedNode], greens + changedNode * MAX_PHASES);
+                    for (int c = w; c < numCandidates; c += workers) { // Apply, score and undo one change
+                        int node = candNode[c];
+                        fillTable(myTable, node, candOffset[c], candGreens + c * MAX_PHASES);
+                        candScore[c] = evaluateSignalPlan(hopStart, hopNode, hopTable, hopWeight, numRoutes, cycle, myTable, nullptr);
+                        fillTable(myTable, node, offset[node], greens + node * MAX_PHASES);
+                    }
+                    roundBarrier.wait(); // Round done
+                }
+                delete[] myTable;
+            });
+        }
+
+        long long evaluations = 1;
+        int step = 16;
+        int rounds = 0;
+        auto start_time = chrono::high_resolution_clock::now();
+
+        while (step >= 1 && rounds < MAX_ROUNDS) {
+            rounds++;
+            numCandidates = 0;
+            for (int i = 0; i < n; i++) {
+                if (!used[i]) continue;
+                int* g = greens + i * MAX_PHASES;
+                if (phases[i] == 1) { // Longer or shorter green within the same cycle
+                    int options[2] = {g[0] + step, g[0] - step};
+                    for (int k = 0; k < 2; k++) {
+                        if (options[k] < MIN_GREEN || options[k] > cycle[i] - MIN_RED) continue;
+                        candNode[numCandidates] = i;
+                        candOffset[numCandidates] = offset[i];
+                        for (int p = 0; p < MAX_PHASES; p++) candGreens[numCandidates * MAX_PHASES + p] = g[p];
+                        candGreens[numCandidates * MAX_PHASES] = options[k];
+                        numCandidates++;
+                    }
+                } else {
+                    for (int p = 0; p < phases[i]; p++) { // Phase p takes step seconds from the next phase
+                        int q = (p + 1) % phases[i];
+                        if (g[q] - step < MIN_GREEN) continue;
+                        candNode[numCandidates] = i;
+                        candOffset[numCandidates] = offset[i];
+                        for (int k = 0; k < MAX_PHASES; k++) candGreens[numCandidates * MAX_PHASES + k] = g[k];
+                        candGreens[numCandidates * MAX_PHASES + p] += step;
+                        candGreens[numCandidates * MAX_PHASES + q] -= step;
+                        numCandidates++;
+                    }
+                }
+                if (step < cycle[i]) {
+                    int shifts[2] = {(offset[i] + step) % cycle[i], (offset[i] - step + cycle[i]) % cycle[i]};
+                    for (int k = 0; k < 2; k++) {
+                        candNode[numCandidates] = i;
+                        candOffset[numCandidates] = shifts[k];
+                        for (int p = 0; p < MAX_PHASES; p++) candGreens[numCandidates * MAX_PHASES + p] = g[p];
+                        numCandidates++;
+                    }
+                }
+            }
+            if (numCandidates == 0) break;
+
+            roundBarrier.wait(); // Hand the candidates to the workers
+            roundBarrier.wait(); // and wait for their scores
+            evaluations += numCandidates;
+
+            int best = 0;
+            for (int c = 1; c < numCandidates; c++) {
+                if (candScore[c] < candScore[best]) best = c;
+            }
+            changedNode = -1;
+            if (candScore[best] < current) { // Keep the best change and search around it again
+                current = candScore[best];
+                int node = candNode[best];
+                offset[node] = candOffset[best];
+                for (int p = 0; p < MAX_PHASES; p++) greens[node * MAX_PHASES + p] = candGreens[best * MAX_PHASES + p];
+                fillTable(waitTable, node, offset[node], greens + node * MAX_PHASES);
+                changedNode = node;
+            } else {
+                step /= 2; // Nothing improves at this step size, look closer
+            }
+        }
+        finished = true;
+        roundBarrier.wait(); // Releases the workers to exit
+        for (int w = 0; w < workers; w++) pool[w].join();
+        delete[] pool;
+
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start_time;
+        evaluateSignalPlan(hopStart, hopNode, hopTable, hopWeight, numRoutes, cycle, waitTable, waitAfter);
+
+        cout << "Evaluated " << evaluations << " timing plans in " << rounds << " rounds (" << elapsed.count() << " s";
+        if (elapsed.count() > 0) cout << ", " << static_cast<long long>(evaluations / elapsed.count()) << " plans/s";
+        cout << ")." << endl;
+        cout << "Total fleet waiting time: " << baseline << " s -> " << current << " s" << endl;
+        for (int i = 0; i < n; i++) { // Show the intersections vehicles pass through
+            if (!used[i]) continue;
+            cout << getNode(i)->name << ": green " << getNode(i)->timing << " -> " << greens[i * MAX_PHASES]
+                 << ", offset " << getNode(i)->offset << " -> " << offset[i]
+                 << ", waiting " << waitBefore[i] << " s -> " << waitAfter[i] << " s" << endl;
+        }
+
+        ofstream file(outputFile);
+        file << "Intersection,GreenTime(s),Offset(s),CycleLength(s),PhaseGreens(s)" << endl;
+        for (int i = 0; i < n; i++) {
+            file << getNode(i)->name << "," << greens[i * MAX_PHASES] << "," << offset[i] << "," << cycle[i] << ",";
+            for (int p = 0; p < phases[i]; p++) {
+                file << greens[i * MAX_PHASES + p];
+                if (p + 1 < phases[i]) file << ";";
+            }
+            file << endl;
+        }
+        file.close();
+        cout << "Optimized timings written to " << outputFile << endl;
+
+        delete[] hopStart; // Free memory
+        delete[] hopNode;
+        delete[] hopTable;
+        delete[] hopWeight;
+        delete[] used;
+        delete[] cycle;
+        delete[] offset;
+        delete[] phases;
+        delete[] greens;
+        delete[] tableStart;
+        delete[] waitTable;
+        delete[] waitBefore;
+        delete[] waitAfter;
+        delete[] candNode;
+        delete[] candOffset;
+        delete[] candGreens;
+        delete[] candScore;
+    }
+
+    /* Vehicles with the same origin and destination form one group. Alternative
+     routes are computed once per group and its vehicles are spread across them,
+     so one road doesn't get every vehicle of a busy origin-destination pair.
+     Fills one route per vehicle, not found when there is none*/
+    void assignVehicleRoutes(Route* routes) {
+        const int ALT_ROUTES = 3;
+        int tableSize = 16;
+        long long* groupKeys = new long long[tableSize]; // Open addressing table: OD key -> group, kept at most half full
+        int* groupSlots = new int[tableSize];
+        for (int i = 0; i < tableSize; i++) groupSlots[i] = -1;
+        int* vehicleGroup = new int[fleet.size > 0 ? fleet.size : 1]; // -1 for vehicles without a trip
+        int groupCapacity = 16;
+        int* groupFirst = new int[groupCapacity]; // First vehicle of each group
+        int numGroups = 0;
+
+        for (int i = 0; i < fleet.size; i++) { // Find the group of every vehicle first, so the group arrays fit exactly
+            vehicleGroup[i] = -1;
+            if (fleet.origin[i] == -1) continue; // Its trip was removed with an intersection
+            long long key = static_cast<long long>(fleet.origin[i]) * getnumNodes() + fleet.destination[i];
+            int slot = static_cast<int>(key % tableSize);
+            while (groupSlots[slot] != -1 && groupKeys[slot] != key) slot = (slot + 1) % tableSize;
+            if (groupSlots[slot] == -1) { // First vehicle of this pair
+                if (numGroups == groupCapacity) { // Double the group list when full
+                    int* newFirst = new int[groupCapacity * 2];
+                    for (int g = 0; g < numGroups; g++) newFirst[g] = groupFirst[g];
+                    delete[] groupFirst;
+                    groupFirst = newFirst;
+                    groupCapacity *= 2;
+                }
+                groupKeys[slot] = key;
+                groupSlots[slot] = numGroups;
+                groupFirst[numGroups++] = i;
+                if (numGroups * 2 > tableSize) { // Double the table and rehash the groups
+                    delete[] groupKeys;
+                    delete[] groupSlots;
+                    tableSize *= 2;
+                    groupKeys = new long long[tableSize];
+                    groupSlots = new int[tableSize];
+                    for (int s = 0; s < tableSize; s++) groupSlots[s] = -1;
+                    for (int g = 0; g < numGroups; g++) {
+                        int v = groupFirst[g];
+                        long long groupKey = static_cast<long long>(fleet.origin[v]) * getnumNodes() + fleet.destination[v];
+                        int s = static_cast<int>(groupKey % tableSize);
+                        while (groupSlots[s] != -1) s = (s + 1) % tableSize;
+                        groupKeys[s] = groupKey;
+                        groupSlots[s] = g;
+                    }
+                }
+                vehicleGroup[i] = numGroups - 1;
             } else {
-                i++; // Move to the next edge if no match
+                vehicleGroup[i] = groupSlots[slot];
             }
         }
 
-        if (!edgeDeleted) {
-            cout << "No edge found between " << fromNode << " and " << toNode << " with weight " << weight << "." << endl;
+        Route* groupRoutes = new Route[static_cast<long long>(numGroups) * ALT_ROUTES + 1]; // Alternative routes of group g start at g * ALT_ROUTES
+        int* groupRouteCount = new int[numGroups > 0 ? numGroups : 1];
+        int* groupDispatched = new int[numGroups > 0 ? numGroups : 1]; // Vehicles already assigned in each group
+        for (int g = 0; g < numGroups; g++) { // Compute each group's routes once
+            int v = groupFirst[g];
+            long long costs[ALT_ROUTES];
+            groupRouteCount[g] = kAlternativeRoutes(getNode(fleet.origin[v])->name, getNode(fleet.destination[v])->name,
+                                                    ALT_ROUTES, groupRoutes + g * ALT_ROUTES, costs);
+            groupDispatched[g] = 0;
         }
 
-        updateEdgeFile(fromNode); // Update the edge file after deletion
-    }
+        for (int i = 0; i < fleet.size; i++) { // Calculate paths for each vehicle
+            routes[i] = Route();
+            int group = vehicleGroup[i];
+            if (group == -1) continue;
 
-    void updateEdgeFile(const string& nodeName) {
-        ifstream infile("road_network.csv");
-        ofstream outfile("temp.csv");
+            if (groupRouteCount[group] == 0) {    // If no path is found, print an error and skip the vehicle
+                cerr << "No path found for vehicle " << fleet.idOf(i) << endl;
+                continue;
+            }
+            int route = 0; // Emergency vehicles always take the fastest route
+            if (fleet.priority[i] != PRIORITY_HIGH) {
+                route = groupDispatched[group]++ % groupRouteCount[group];
+            }
+            routes[i] = groupRoutes[group * ALT_ROUTES + route].clone();
+        }
 
-        string from, to, header;
-        int weight;
+        delete[] groupRoutes;
+        delete[] groupRouteCount;
+        delete[] groupDispatched;
+        delete[] groupFirst;
+        delete[] vehicleGroup;
+        delete[] groupKeys;
+        delete[] groupSlots;
+    }
 
-        if (getline(infile, header)) {
-            outfile << header << endl; // Copy the header to the temp file
+    /* Everything a checkpoint relies on but doesn't store: the roads and the
+     IDs of the fleet. Resuming with other roads or vehicles is refused*/
+    unsigned int checkpointFingerprint(const GraphSnapshot* snap) {
+        unsigned int hash = fnvHash(nullptr, 0);
+        for (int i = 0; i < snap->numNodes; i++) {
+            hash = fnvHash(snap->nodes[i].name.data(), static_cast<int>(snap->nodes[i].name.size()), hash);
         }
+        int nodeIdBytes = snap->numEdges * static_cast<int>(sizeof(NodeId));
+        hash = fnvHash(reinterpret_cast<const char*>(snap->tail), nodeIdBytes, hash);
+        hash = fnvHash(reinterpret_cast<const char*>(snap->head), nodeIdBytes, hash);
+        hash = fnvHash(reinterpret_cast<const char*>(snap->routeWeight), snap->numEdges * static_cast<int>(sizeof(Weight)), hash); // Carries closed roads too
+        hash = fnvHash(fleet.idPool, fleet.idStart[fleet.size], hash);
+        return fnvHash(reinterpret_cast<const char*>(fleet.idStart), (fleet.size + 1) * static_cast<int>(sizeof(int)), hash);
+    }
 
-        /* Copy all edges except the
-         ones related to 'nodeName'*/
-        while (getline(infile, from, ',')) {
-            getline(infile, to, ',');
-            infile >> weight;
-            infile.ignore(__LONG_MAX__, '\n');
+    void writeVehicleState(ByteBuffer& buffer, int i, const Route* routes) {
+        buffer.putInt(fleet.position[i]);
+        buffer.putInt(fleet.departureTime[i]);
+        routes[i].encode(buffer);
+    }
 
-            if (from == nodeName || to == nodeName) {
-                continue; // Skip if it's the edge to delete
-            }
+    bool readVehicleState(ByteReader& reader, const GraphSnapshot* snap, int& position, int& departureTime, Route& route) {
+        return reader.getInt(position) && reader.getInt(departureTime) && route.decode(reader, snap);
+    }
 
-            outfile << from << "," << to << "," << weight << endl; // Write the valid edge to the temp file
-        }
+    void writeQueueStats(ByteBuffer& buffer, const QueueStats& stats, int travelling) {
+        buffer.putInt(travelling);
+        buffer.putLong(stats.entered);
+        buffer.putLong(stats.moved);
+        buffer.putLong(stats.arrived);
+        buffer.putLong(stats.redStops);
+        buffer.putLong(stats.spillbacks);
+        buffer.putInt(stats.longestQueue);
+    }
 
-        infile.close();
-        outfile.close();
+    bool readQueueStats(ByteReader& reader, QueueStats& stats, int& travelling) {
+        return reader.getInt(travelling) && reader.getLong(stats.entered) && reader.getLong(stats.moved) && reader.getLong(stats.arrived)
+               && reader.getLong(stats.redStops) && reader.getLong(stats.spillbacks) && reader.getInt(stats.longestQueue);
+    }
 
-        remove("road_network.csv"); // Delete old file
-        rename("temp.csv", "road_network.csv"); // Rename temp file to original file name
+    void writeRoadState(ByteBuffer& buffer, int e, const RoadQueues& queues) { // The road's vehicles from the front and its hold
+        buffer.putInt(e);
+        buffer.putInt(queues.count[e]);
+        buffer.putInt(queues.held[e] ? 1 : 0);
+        for (int k = 0; k < queues.count[e]; k++) buffer.putInt(queues.at(e, k));
     }
 
-    void updateNodeFile(const string& nodeName) {
-        ifstream infile("traffic_signal_timings.csv");
-        ofstream outfile("temp.csv");
+    void writeRingState(ByteBuffer& buffer, int e, const CongestionMonitor& monitor) { // The road's occupancy history, in ring order
+        unsigned char ring[255];
+        for (int t = 0; t < monitor.window; t++) ring[t] = monitor.samples[static_cast<long long>(t) * monitor.queues.numRoads + e];
+        buffer.putInt(monitor.lastChange[e]);
+        buffer.append(ring, monitor.window);
+    }
 
-        string node;
-        int timings;
+    /* Serializes the state after tick into the writer's free buffer. A full
+     record holds the signal settings, the counters of the run, the whole
+     occupancy table, every road queue with its congestion history and every
+     vehicle. A delta holds the counters and only the vehicles and roads
+     marked dirty since the last record, each road with its occupancy entry.
+     Returns false (and keeps the dirty marks) if the writer is still busy
+     with the previous checkpoint*/
+    bool saveCheckpoint(CheckpointWriter& writer, bool full, int tick, const GraphSnapshot* snap, const Route* routes,
+                        const RoadQueues& queues, QueueFleet& q, const QueueStats& stats, int travelling) {
+        if (writer.busy()) {
+            writer.recordsSkipped++;
+            return false;
+        }
+        ByteBuffer& buffer = writer.begin(full ? CHECKPOINT_FULL : CHECKPOINT_DELTA);
+        buffer.putInt(tick);
+        if (full) {
+            buffer.putInt(static_cast<int>(checkpointFingerprint(snap)));
+            buffer.putInt(snap->numNodes);
+            for (int i = 0; i < snap->numNodes; i++) { // Signal phases the run was using
+                const Nodes& node = snap->nodes[i];
+                int signal[4] = {node.timing, node.offset, node.cycle, node.numPhases};
+                buffer.putInts(signal, 4);
+                buffer.putInts(node.phaseGreen, MAX_PHASES);
+            }
+        }
+        writeQueueStats(buffer, stats, travelling);
+        if (full) {
+            buffer.putInt(getOccupancySize()); // Vehicles on each road
+            buffer.putInts(getOccupancy(), getOccupancySize());
+            buffer.putInt(q.monitor->window);
+        }
+        int numRoads = 0;
+        for (int e = 0; e < queues.numRoads; e++) {
+            if (full || q.dirtyRoad[e]) numRoads++;
+        }
+        buffer.putInt(numRoads);
+        for (int e = 0; e < queues.numRoads; e++) {
+            if (!full && !q.dirtyRoad[e]) continue;
+            writeRoadState(buffer, e, queues);
+            writeRingState(buffer, e, *q.monitor);
+            if (!full) {
+                buffer.putInt(q.occupancySlot[e]);
+                buffer.putInt(q.occupancy[q.occupancySlot[e]]);
+            }
+            q.dirtyRoad[e] = false;
+        }
 
-        bool headerRead = false;
+        int numDirty = 0;
+        for (int i = 0; i < fleet.size; i++) {
+            if (q.dirty[i]) numDirty++;
+        }
+        buffer.putInt(full ? fleet.size : numDirty);
+        for (int i = 0; i < fleet.size; i++) {
+            if (!full && !q.dirty[i]) continue;
+            if (!full) buffer.putInt(i);
+            writeVehicleState(buffer, i, routes);
+            q.dirty[i] = false;
+        }
+        writer.submit(full);
+        return true;
+    }
 
-        while (infile.good()) {
-            if (!headerRead) {
-                string header;
-                getline(infile, header);
-                outfile << header << endl; // Write the header to the temp file
-                headerRead = true;
+    /* Replays a checkpoint file: the full record it starts with, then every
+     intact delta after it. A record cut short by a crash ends the replay.
+     Records are decoded into copies that only replace the live state once the
+     whole file checked out, so a refused resume leaves everything as it was.
+     stats and travelling get the counters of the interrupted run*/
+    bool loadCheckpoint(const string& file, const GraphSnapshot* snap, int& tick, Route* routes, RoadQueues& queues,
+                        CongestionMonitor& monitor, QueueStats& stats, int& travelling) {
+        ifstream in(file, ios::binary | ios::ate);
+        if (!in.is_open()) {
+            cout << "Could not open " << file << endl;
+            return false;
+        }
+        int size = static_cast<int>(in.tellg());
+        char* data = new char[size > 0 ? size : 1];
+        in.seekg(0);
+        in.read(data, size);
+        in.close();
+
+        int occupancySize = getOccupancySize();
+        int* occupancy = new int[occupancySize > 0 ? occupancySize : 1];
+        int* position = new int[fleet.size > 0 ? fleet.size : 1];
+        int* departureTime = new int[fleet.size > 0 ? fleet.size : 1];
+        Route* loadedRoutes = new Route[fleet.size > 0 ? fleet.size : 1];
+        int loadedTick = 0, loadedTravelling = 0;
+        QueueStats loadedStats;
+        int* queueCount = new int[queues.numRoads > 0 ? queues.numRoads : 1];
+        int* queuePool = new int[queues.start[queues.numRoads] > 0 ? queues.start[queues.numRoads] : 1]; // Each road's vehicles from the front
+        bool* queueHeld = new bool[queues.numRoads > 0 ? queues.numRoads : 1];
+        long long ringBytes = static_cast<long long>(queues.numRoads > 0 ? queues.numRoads : 1) * monitor.window;
+        unsigned char* ringSamples = new unsigned char[ringBytes];
+        int* ringLastChange = new int[queues.numRoads > 0 ? queues.numRoads : 1];
+        unsigned char ring[255];
+
+        const int HEADER_BYTES = CHECKPOINT_HEADER_INTS * static_cast<int>(sizeof(int));
+        int pos = 0, records = 0;
+        bool ok = true;
+        while (ok && pos + HEADER_BYTES <= size) {
+            int header[CHECKPOINT_HEADER_INTS];
+            memcpy(header, data + pos, HEADER_BYTES);
+            int payloadSize = header[2];
+            if (header[0] != CHECKPOINT_MAGIC || payloadSize < 0 || payloadSize > size - pos - HEADER_BYTES) break; // Torn record
+            const char* payload = data + pos + HEADER_BYTES;
+            if (static_cast<int>(fnvHash(payload, payloadSize)) != header[3]) break;
+            if (records == 0 && header[1] != CHECKPOINT_FULL) break; // Deltas need a full record before them
+
+            ByteReader reader(payload, payloadSize);
+            ok = reader.getInt(loadedTick);
+            if (ok && header[1] == CHECKPOINT_FULL) {
+                int fingerprint, numNodes;
+                ok = reader.getInt(fingerprint) && reader.getInt(numNodes);
+                if (ok && (fingerprint != static_cast<int>(checkpointFingerprint(snap)) || numNodes != snap->numNodes)) {
+                    cout << "The checkpoint was taken with different roads or vehicles." << endl;
+                    ok = false;
+                }
+                for (int i = 0; i < numNodes && ok; i++) {
+                    int signal[4 + MAX_PHASES];
+                    ok = reader.getInts(signal, 4 + MAX_PHASES);
+                    const Nodes& node = snap->nodes[i];
+                    if (ok && (signal[0] != node.timing || signal[1] != node.offset || signal[2] != node.cycle || signal[3] != node.numPhases
+                               || memcmp(signal + 4, node.phaseGreen, sizeof(node.phaseGreen)) != 0)) {
+                        cout << "The signal timings of " << node.name << " differ from the checkpoint." << endl;
+                        ok = false;
+                    }
+                }
             }
-            
-            getline(infile, node, ','); // Read node name
-            if (node.empty()) continue; // Skip if node is empty
-            
-            infile >> timings; // Read timings
-            infile.ignore(__LONG_MAX__, '\n'); // Move to the next line
+            ok = ok && readQueueStats(reader, loadedStats, loadedTravelling);
+            int recordOccupancy = 0, numRoads = 0, numVehicles = 0;
+            if (ok && header[1] == CHECKPOINT_FULL) {
+                int window;
+                ok = reader.getInt(recordOccupancy) && recordOccupancy == occupancySize && reader.getInts(occupancy, occupancySize)
+                     && reader.getInt(window) && window == monitor.window;
+            }
+            ok = ok && reader.getInt(numRoads) && numRoads >= 0 && numRoads <= queues.numRoads;
+            if (ok && header[1] == CHECKPOINT_FULL) ok = numRoads == queues.numRoads; // A delta only lists the roads that changed
+            for (int r = 0; r < numRoads && ok; r++) {
+                int e, held;
+                ok = reader.getInt(e) && e >= 0 && e < queues.numRoads && (header[1] != CHECKPOINT_FULL || e == r)
+                     && reader.getInt(queueCount[e]) && queueCount[e] >= 0 && queueCount[e] <= queues.storage(e)
+                     && reader.getInt(held) && (held == 0 || (held == 1 && queueCount[e] > 0))
+                     && reader.getInts(queuePool + queues.start[e], queueCount[e]);
+                for (int k = 0; k < queueCount[e] && ok; k++) {
+                    int vehicle = queuePool[queues.start[e] + k];
+                    ok = vehicle >= 0 && vehicle < fleet.size;
+                }
+                if (ok) queueHeld[e] = held == 1;
+                ok = ok && reader.getInt(ringLastChange[e]) && reader.getBytes(ring, monitor.window);
+                for (int t = 0; t < monitor.window && ok; t++) {
+                    ok = ring[t] <= 100;
+                    ringSamples[static_cast<long long>(t) * queues.numRoads + e] = ring[t];
+                }
+                if (ok && header[1] == CHECKPOINT_DELTA) {
+                    int slot, value;
+                    ok = reader.getInt(slot) && slot >= 0 && slot < occupancySize && reader.getInt(value);
+                    if (ok) occupancy[slot] = value;
+                }
+            }
+            ok = ok && reader.getInt(numVehicles);
+            if (ok && header[1] == CHECKPOINT_FULL) {
+                ok = numVehicles == fleet.size;
+                for (int i = 0; i < numVehicles && ok; i++) ok = readVehicleState(reader, snap, position[i], departureTime[i], loadedRoutes[i]);
+            } else if (ok) {
+                for (int k = 0; k < numVehicles && ok; k++) {
+                    int i;
+                    ok = reader.getInt(i) && i >= 0 && i < fleet.size && readVehicleState(reader, snap, position[i], departureTime[i], loadedRoutes[i]);
+                }
+            }
+            pos += HEADER_BYTES + payloadSize;
+            records++;
+        }
+        delete[] data;
+
+        if (ok && records > 0) { // The first record was full, so every copy is filled in
+            tick = loadedTick;
+            stats = loadedStats;
+            travelling = loadedTravelling;
+            memcpy(getOccupancy(), occupancy, occupancySize * sizeof(int));
+            for (int i = 0; i < fleet.size; i++) {
+                fleet.position[i] = position[i];
+                fleet.departureTime[i] = departureTime[i];
+                routes[i] = move(loadedRoutes[i]);
+            }
+            for (int e = 0; e < queues.numRoads; e++) {
+                queues.head[e] = 0;
+                queues.count[e] = queueCount[e];
+                queues.held[e] = queueHeld[e];
+                memcpy(queues.pool + queues.start[e], queuePool + queues.start[e], queueCount[e] * sizeof(int));
+                monitor.lastChange[e] = ringLastChange[e];
+            }
+            memcpy(monitor.samples, ringSamples, static_cast<long long>(queues.numRoads) * monitor.window);
+            monitor.restore(tick);
+        }
+        delete[] queueCount;
+        delete[] queuePool;
+        delete[] queueHeld;
+        delete[] ringSamples;
+        delete[] ringLastChange;
+        delete[] occupancy;
+        delete[] position;
+        delete[] departureTime;
+        delete[] loadedRoutes;
+
+        if (!ok || records == 0) {
+            cout << "Could not resume from " << file << "." << endl;
+            return false;
+        }
+        cout << "Resuming after time " << tick << " from " << records << " checkpoint records." << endl;
+        return true;
+    }
 
-            if (node != nodeName) {
-                outfile << node << "," << timings << endl; // Write the valid node to the temp file
+    /* One second of the queue model. Vehicles at their origin enter their
+     first road when it has room. Each road then lets at most its discharge
+     rate of vehicles past the stop line, only on green (emergency vehicles
+     don't stop). The front vehicle is held while the road it turns into is
+     full and everyone behind it waits too, so a full road spills back*/
+    void queueTick(const GraphSnapshot* snap, RoadQueues& queues, QueueFleet& q, int now, QueueStats& stats, bool print) {
+        auto label = [&](int v) { return (q.priority[v] == PRIORITY_HIGH ? "Emergency Vehicle " : "Vehicle ") + fleet.idOf(v); };
+        auto enter = [&](int e, int v) {
+            queues.push(e, v);
+            q.readyTime[v] = now + snap->weight[e];
+            if (q.occupancy != nullptr) q.occupancy[q.occupancySlot[e]]++;
+            if (q.monitor != nullptr) q.monitor->changed(e, now);
+            if (q.dirty != nullptr) q.dirty[v] = true;
+            if (q.dirtyRoad != nullptr) q.dirtyRoad[e] = true;
+        };
+        auto leave = [&](int e) {
+            queues.pop(e);
+            if (q.occupancy != nullptr) q.occupancy[q.occupancySlot[e]]--;
+            if (q.monitor != nullptr) q.monitor->changed(e, now);
+            if (q.dirtyRoad != nullptr) q.dirtyRoad[e] = true;
+        };
+
+        int kept = 0;
+        for (int k = 0; k < q.numPending; k++) {
+            int v = q.pending[k];
+            int first = q.hopSlot[q.hopStart[v]];
+            if (queues.full(first)) { // Spilled back to the origin
+                q.pending[kept++] = v;
+                continue;
             }
+            q.position[v] = 0;
+            enter(first, v);
+            stats.entered++;
+            if (print) cout << label(v) << " leaves " << snap->nodes[snap->tail[first]].name << " at time " << now << " seconds." << endl;
         }
+        q.numPending = kept;
+
+        for (int e = 0; e < queues.numRoads; e++) {
+            int budget = snap->discharge[e];
+            while (queues.count[e] > 0 && budget > 0) {
+                int v = queues.front(e);
+                if (q.readyTime[v] > now) break; // Still driving to the stop line
+                if (q.priority[v] != PRIORITY_HIGH && !is_light_green(snap, e, now)) {
+                    int wait_time = calculate_wait_time(snap, e, now);
+                    q.readyTime[v] = now + wait_time;
+                    if (q.dirty != nullptr) q.dirty[v] = true;
+                    stats.redStops++;
+                    if (print) cout << label(v) << " is waiting at " << snap->nodes[snap->head[e]].name << " for " << wait_time << " seconds." << endl;
+                    break;
+                }
+                int hop = q.hopStart[v] + q.position[v] + 1;
+                if (hop == q.hopStart[v + 1]) { // Last road of its route
+                    leave(e);
+                    q.position[v]++;
+                    if (q.dirty != nullptr) q.dirty[v] = true;
+                    stats.arrived++;
+                    if (print) cout << label(v) << " reaches " << snap->nodes[snap->head[e]].name << " at time " << now << " seconds." << endl;
+                } else {
+                    int next = q.hopSlot[hop];
+                    if (queues.full(next)) {
+                        if (queues.held[e]) break; // Reported when it started
+                        queues.held[e] = true;
+                        if (q.dirtyRoad != nullptr) q.dirtyRoad[e] = true;
+                        stats.spillbacks++;
+                        if (print) cout << label(v) << " is held at " << snap->nodes[snap->head[e]].name << ", the road to "
+                                        << snap->nodes[snap->head[next]].name << " is full." << endl;
+                        break;
+                    }
+                    leave(e);
+                    q.position[v]++;
+                    enter(next, v);
+                    stats.moved++;
+                    if (print) cout << label(v) << " moves to " << snap->nodes[snap->head[e]].name << " at time " << now << " seconds." << endl;
+                }
+                budget--;
+            }
+            if (queues.count[e] > stats.longestQueue) stats.longestQueue = queues.count[e];
+        }
+        if (q.monitor != nullptr) q.monitor->sample(now);
+    }
 
-        infile.close();
-        outfile.close();
+    /* What operators see while a simulation runs: how many roads were at
+     least CONGESTION_THRESHOLD percent full on average over the monitor's
+     window, and the CONGESTION_TOP worst of them*/
+    void displayWorstRoads(const GraphSnapshot* snap, CongestionMonitor& monitor, int now) {
+        int roads[CONGESTION_TOP];
+        int congested = monitor.overThreshold(CONGESTION_THRESHOLD, roads, 0);
+        int count = monitor.worst(CONGESTION_TOP, roads);
+        cout << "Congestion at time " << now << " seconds: " << congested << " roads at least " << CONGESTION_THRESHOLD
+             << "% full over the last " << monitor.window << " seconds." << endl;
+        for (int k = 0; k < count; k++) {
+            int e = roads[k];
+            cout << "  " << snap->nodes[snap->tail[e]].name << " -> " << snap->nodes[snap->head[e]].name << ": "
+                 << monitor.meanPercent(e) << "% full on average, full for " << monitor.fullTicks(e) << " s, "
+                 << monitor.queues.count[e] << " of " << monitor.queues.storage(e) << " vehicles now" << endl;
+        }
+    }
 
-        remove("traffic_signal_timings.csv"); // Delete old file
-        rename("temp.csv", "traffic_signal_timings.csv"); // Rename temp file to original file name
+    /* Drives numVehicles random 16 road trips through the queues of a
+     synthetic network holding 4 to 16 vehicles per road, and times the
+     ticks while most of them are queued*/
+    void benchmarkRoadQueues(int numVehicles) {
+        const int NUM_NODES = 200000;
+        const int HOPS = 16;
+        const int MAX_TICKS = 600;
+        if (numVehicles < 1) numVehicles = 1;
+        GraphSnapshot* snap = buildSyntheticSnapshot(NUM_NODES, 4, 30, 99);
+        RoadQueues queues(snap->storage, snap->numEdges);
+        cout << "Synthetic network: " << snap->numNodes << " nodes, " << snap->numEdges << " roads, room for "
+             << queues.start[queues.numRoads] << " vehicles" << endl;
+
+        XorShiftRandom random(5);
+        int* hopStart = new int[numVehicles + 1];
+        int* hopSlot = new int[static_cast<long long>(numVehicles) * HOPS];
+        unsigned char* priority = new unsigned char[numVehicles];
+        int* position = new int[numVehicles];
+        int* readyTime = new int[numVehicles];
+        int* pending = new int[numVehicles];
+        for (int v = 0; v < numVehicles; v++) { // Random walks
+            hopStart[v] = v * HOPS;
+            int u = random.below(snap->numNodes);
+            for (int h = 0; h < HOPS; h++) {
+                int e = snap->firstOut[u] + random.below(snap->firstOut[u + 1] - snap->firstOut[u]);
+                hopSlot[v * HOPS + h] = e;
+                u = snap->head[e];
+            }
+            priority[v] = PRIORITY_LOW;
+            position[v] = -1;
+            readyTime[v] = 0;
+            pending[v] = v;
+        }
+        hopStart[numVehicles] = numVehicles * HOPS;
+
+        QueueFleet q;
+        q.size = numVehicles;
+        q.hopStart = hopStart;
+        q.hopSlot = hopSlot;
+        q.position = position;
+        q.readyTime = readyTime;
+        q.priority = priority;
+        q.pending = pending;
+        q.numPending = numVehicles;
+        q.dirty = nullptr;
+        q.dirtyRoad = nullptr;
+        q.occupancy = nullptr;
+        q.occupancySlot = nullptr;
+        CongestionMonitor monitor(queues, CONGESTION_WINDOW);
+        q.monitor = &monitor;
+
+        QueueStats stats;
+        long long queuedSum = 0, sampledSum = 0;
+        int peakQueued = 0, ticks = 0, congested = 0;
+        int worstRoads[CONGESTION_TOP];
+        chrono::duration<double, milli> tickTime(0), queryTime(0);
+        while (stats.arrived < numVehicles && ticks < MAX_TICKS) {
+            auto start = chrono::high_resolution_clock::now();
+            queueTick(snap, queues, q, ticks, stats, false);
+            tickTime += chrono::high_resolution_clock::now() - start;
+            sampledSum += monitor.numActive;
+            start = chrono::high_resolution_clock::now();
+            monitor.worst(CONGESTION_TOP, worstRoads); // What a simulation shows its operators
+            congested = monitor.overThreshold(CONGESTION_THRESHOLD, worstRoads, 0);
+            queryTime += chrono::high_resolution_clock::now() - start;
+            int queued = queues.queued();
+            queuedSum += queued;
+            if (queued > peakQueued) peakQueued = queued;
+            ticks++;
+        }
+        cout << "  " << ticks << " ticks, " << tickTime.count() / ticks << " ms per tick, "
+             << static_cast<long long>(queuedSum / ticks) << " vehicles on the roads on average, " << peakQueued << " at most" << endl;
+        cout << "  " << stats.arrived << " of " << numVehicles << " vehicles arrived, " << stats.moved << " road changes, "
+             << stats.spillbacks << " spillback holds, longest queue " << stats.longestQueue << " vehicles" << endl;
+        if (tickTime.count() > 0) {
+            cout << "  " << static_cast<long long>(queuedSum / (tickTime.count() / 1000.0)) << " queued vehicles processed per second" << endl;
+        }
+        cout << "  Congestion monitor: " << sampledSum / ticks << " of " << snap->numEdges << " roads sampled per tick on average, worst "
+             << CONGESTION_TOP << " and over " << CONGESTION_THRESHOLD << "% queries " << queryTime.count() * 1000.0 / ticks
+             << " us per tick, " << congested << " roads over " << CONGESTION_THRESHOLD << "% at the end" << endl;
+
+        delete[] hopStart;
+        delete[] hopSlot;
+        delete[] priority;
+        delete[] position;
+        delete[] readyTime;
+        delete[] pending;
+        delete snap;
+    }
+
+    /* Lays the routes of the fleet out back to back, so a tick reads the
+     roads of all vehicles from one array. hopStart gets fleet.size + 1 entries*/
+    void buildHopSlots(const GraphSnapshot* snap, const Route* routes, int* hopStart, int*& hopSlot) {
+        hopStart[0] = 0;
+        for (int i = 0; i < fleet.size; i++) {
+            int hops = routes[i].length;
+            if (hops > 0 && routes[i].version != snap->version) {
+                cerr << "Invalid edge for vehicle " << fleet.idOf(i) << endl; // Routed on other roads, the vehicle stays at its origin
+                hops = 0;
+            }
+            hopStart[i + 1] = hopStart[i] + hops;
+        }
+        hopSlot = new int[hopStart[fleet.size] > 0 ? hopStart[fleet.size] : 1];
+        for (int i = 0; i < fleet.size; i++) {
+            for (int j = 0; j < hopStart[i + 1] - hopStart[i]; j++) hopSlot[hopStart[i] + j] = routes[i].edges[j];
+        }
+    }
+
+   /* Runs in real time, one simulated second per tick. Every road is a FIFO
+    queue holding at most its capacity, emptied at its discharge rate while
+    the light is green, and a full road blocks the one feeding it (see
+    queueTick). Every CHECKPOINT_INTERVAL seconds the state is checkpointed:
+    a full record every CHECKPOINT_FULL_EVERY checkpoints and deltas of the
+    vehicles that changed in between, plus a full record when the run ends.
+    Passing a checkpoint file continues that run from the tick after it was taken.
+    Every CONGESTION_REPORT_INTERVAL seconds and at the end the worst roads of
+    the last CONGESTION_WINDOW seconds are shown (see CongestionMonitor).
+    Without realTime the ticks run back to back, as batch runs do*/
+   void simulate(const string& resumeFrom = "", bool realTime = true) { 
+    int max_simulation_time = 300; // Maximum simulation time
+    const string CHECKPOINT_FILE = "simulation_checkpoint.bin";
+    const int CHECKPOINT_INTERVAL = 10;
+    const int CHECKPOINT_FULL_EVERY = 10;
+    const int CONGESTION_REPORT_INTERVAL = 10;
+
+    Route* routes = new Route[fleet.size];  // Route of each vehicle
+    if (resumeFrom.empty()) {
+        assignVehicleRoutes(routes);
     }
 
-    Nodes** dijkstra(const string& fromNodeName, const string& toNodeName, int& pathLength) {
-        const int INF = 999999; // Use a big number to represent infinity
-        int* dist = new int[numNodes]; // Distance array for shortest paths
-        bool* visited = new bool[numNodes]; // Track visited nodes
-        int* predecessor = new int[numNodes]; // To store the previous node in the path
+    const GraphSnapshot* snap; // Road weights, capacities and signal wait tables for the whole run
+    int readerSlot = pinSnapshot(snap);
+    RoadQueues queues(snap->storage, snap->numEdges);
+    CongestionMonitor monitor(queues, CONGESTION_WINDOW);
+
+    int current_simulation_time = 0;
+    QueueStats stats;
+    int travelling = 0; // Vehicles with a road to drive when the run started
+    if (!resumeFrom.empty()) {
+        if (!loadCheckpoint(resumeFrom, snap, current_simulation_time, routes, queues, monitor, stats, travelling)) {
+            delete[] routes;
+            unpinSnapshot(readerSlot);
+            return;
+        }
+        current_simulation_time++; // The checkpoint was taken at the end of its tick
+    }
+
+    int* hopStart = new int[fleet.size + 1];
+    int* hopSlot;
+    buildHopSlots(snap, routes, hopStart, hopSlot);
+    int* occupancySlot = new int[snap->numEdges > 0 ? snap->numEdges : 1]; // Road hash of each slot, for displayCongestion
+    for (int e = 0; e < snap->numEdges; e++) {
+        occupancySlot[e] = getOccupancyIndex(snap->nodes[snap->tail[e]].name, snap->nodes[snap->head[e]].name);
+    }
 
-        for (int i = 0; i < numNodes; i++) { // Initialize arrays with default values
-            dist[i] = INF; // Set all distances to infinity
-            visited[i] = false; // Mark all nodes as unvisited
-            predecessor[i] = -1; // No predecessors yet
+    bool* dirty = new bool[fleet.size > 0 ? fleet.size : 1]; // Vehicles changed since the last checkpoint
+    for (int i = 0; i < fleet.size; i++) dirty[i] = false;
+    bool* dirtyRoad = new bool[queues.numRoads > 0 ? queues.numRoads : 1]; // Roads changed since the last checkpoint
+    for (int e = 0; e < queues.numRoads; e++) dirtyRoad[e] = false;
+    monitor.dirty = dirtyRoad; // A changed ring goes into the next delta too
+    QueueFleet q;
+    q.size = fleet.size;
+    q.hopStart = hopStart;
+    q.hopSlot = hopSlot;
+    q.position = fleet.position;
+    q.readyTime = fleet.departureTime;
+    q.priority = fleet.priority;
+    q.pending = new int[fleet.size > 0 ? fleet.size : 1];
+    q.numPending = 0;
+    q.dirty = dirty;
+    q.dirtyRoad = dirtyRoad;
+    q.occupancy = getOccupancy();
+    q.occupancySlot = occupancySlot;
+    q.monitor = &monitor;
+    for (int i = 0; i < fleet.size; i++) {
+        int hops = hopStart[i + 1] - hopStart[i];
+        if (resumeFrom.empty()) { // Every vehicle starts at its origin
+            q.position[i] = hops > 0 ? -1 : 0;
+            q.readyTime[i] = 0;
+        } else if (q.position[i] < -1 || q.position[i] > hops) {
+            q.position[i] = hops; // Not a position of this route, take it off the roads
         }
+        if (q.position[i] == -1) q.pending[q.numPending++] = i;
+        if (resumeFrom.empty() && q.position[i] < hops) travelling++;
+    }
+    if (resumeFrom.empty()) {
+        for (int i = 0; i < getOccupancySize(); i++) q.occupancy[i] = 0; // Nobody is on the roads yet
+    }
 
-        int startIdx = -1, endIdx = -1; 
-        for (int i = 0; i < numNodes; i++) {    // Find the index of the start and end nodes
-            if (intersections[i].name == fromNodeName) {
-                startIdx = i;
-            }
-            if (intersections[i].name == toNodeName) {
-                endIdx = i;
+    CheckpointWriter checkpoints(CHECKPOINT_FILE);
+    int checkpointsSinceFull = CHECKPOINT_FULL_EVERY; // The first checkpoint is a full one
+    cout << "Checkpoints are written to " << CHECKPOINT_FILE << " every " << CHECKPOINT_INTERVAL << " seconds." << endl;
+
+    while (stats.arrived < travelling) {  // Continue the simulation until all vehicles reach their destinations
+        queueTick(snap, queues, q, current_simulation_time, stats, true);
+        if (current_simulation_time % CONGESTION_REPORT_INTERVAL == 0) displayWorstRoads(snap, monitor, current_simulation_time);
+
+        if (current_simulation_time % CHECKPOINT_INTERVAL == 0) {
+            bool full = checkpointsSinceFull >= CHECKPOINT_FULL_EVERY;
+            if (saveCheckpoint(checkpoints, full, current_simulation_time, snap, routes, queues, q, stats, travelling)) {
+                checkpointsSinceFull = full ? 1 : checkpointsSinceFull + 1;
             }
         }
-        /*If start or end node is not found,
-         free memory and return null*/ 
-        if (startIdx == -1 || endIdx == -1) {
-            delete[] dist;
-            delete[] visited;
-            delete[] predecessor;
-            pathLength = 0;
-            return nullptr;
+
+        if (stats.arrived < travelling && current_simulation_time < max_simulation_time) {
+            if (realTime) std::this_thread::sleep_for(std::chrono::seconds(1));  // Simulate real time by sleeping 1 second 
+            current_simulation_time++;
+        } else {
+            break;
+        }
+    }
+
+    checkpoints.waitIdle(); // Keep the final state too
+    saveCheckpoint(checkpoints, true, current_simulation_time, snap, routes, queues, q, stats, travelling);
+    checkpoints.finish();
+    cout << "Checkpoint records written: " << checkpoints.recordsWritten << ", skipped while the writer was busy: "
+         << checkpoints.recordsSkipped << endl;
+    if (checkpoints.failed) cerr << "Some checkpoints could not be written to " << CHECKPOINT_FILE << endl;
+    cout << stats.arrived << " of " << travelling << " vehicles arrived, " << queues.queued() << " still on the roads, "
+         << q.numPending << " still at their origin." << endl;
+    cout << "Red light stops: " << stats.redStops << ", spillback holds: " << stats.spillbacks
+         << ", longest queue: " << stats.longestQueue << " vehicles" << endl;
+    displayWorstRoads(snap, monitor, current_simulation_time);
+
+    for (int i = 0; i < fleet.size; i++) { // After the simulation, print the paths for each vehicle
+        if (!routes[i].found() || routes[i].version != snap->version) {
+            cerr << "No path found for vehicle " << fleet.idOf(i) << endl;
+            continue;
+        }
+        cout << "Vehicle " << fleet.idOf(i) << " path: ";
+        for (int j = 0; j <= routes[i].length; j++) {
+            cout << snap->nodes[routes[i].node(snap, j)].name;
+            if (j < routes[i].length) cout << " -> ";
         }
+        if (q.position[i] == hopStart[i + 1] - hopStart[i]) cout << " Destination Reached." << endl;
+        else cout << " Still on the way." << endl;
+        cout << endl;
+    }
 
-        dist[startIdx] = 0; // Distance to the start node is 0
+    delete[] routes; // Clean up memory 
+    delete[] dirty;
+    delete[] dirtyRoad;
+    delete[] hopStart;
+    delete[] hopSlot;
+    delete[] occupancySlot;
+    delete[] q.pending;
+    unpinSnapshot(readerSlot);
 
-        for (int i = 0; i < numNodes; i++) { // Start the Dijkstra's algorithm
-            int u = -1, minDist = INF;
-            for (int j = 0; j < numNodes; j++) { // Find the unvisited node with the smallest distance
-                if (!visited[j] && dist[j] < minDist) {
-                    minDist = dist[j];
-                    u = j;
+    cout << "Simulation complete." << endl;
+}
+
+    /* Simulation fed by a stream of trips that keep arriving while it runs.
+     A reader thread tails the trip file (lines ID,Start,End,Departure[,Priority],
+     a named pipe works too) into a bounded queue, a router thread computes each
+     trip's shortest route and hands it on through a second queue, and this
+     thread injects routed trips into the event heap at their departure time.
+     With follow set the file is watched for new lines until the time limit,
+     otherwise the run ends once the file is used up and every vehicle arrived.
+     speed is simulated seconds per real second, 0 runs as fast as possible.
+     Streamed vehicles are kept for the run only, the fleet doesn't change*/
+    void streamingSimulation(const string& tripFile, bool follow, int speed, int max_simulation_time = 300) {
+        ifstream file(tripFile);
+        if (!file.is_open()) {
+            cout << "Could not open " << tripFile << endl;
+            return;
+        }
+        const int QUEUE_SIZE = 1024;
+        SpscQueue<TripRequest> parsedTrips(QUEUE_SIZE); // Reader -> router
+        SpscQueue<TripRequest> routedTrips(QUEUE_SIZE); // Router -> simulation
+        atomic<bool> stop(false);
+        atomic<bool> readerDone(false);
+        atomic<bool> readerIdle(false); // Reader is at the end of the file
+        atomic<bool> routerDone(false);
+        atomic<long long> tripsRead(0), malformed(0), tripsRouted(0), routingNanos(0);
+        atomic<long long> readerStalls(0), routerStalls(0); // Times a stage found the next queue full
+
+        const GraphSnapshot* snap; // Road weights and signal wait tables for the whole run
+        int readerSlot = pinSnapshot(snap);
+
+        thread reader([&]() {
+            string line, partial;
+            while (!stop.load()) {
+                if (!getline(file, line)) { // End of the file for now
+                    readerIdle.store(true);
+                    if (!follow) break;
+                    file.clear(); // Wait for the writer to append more lines
+                    this_thread::sleep_for(chrono::milliseconds(50));
+                    continue;
+                }
+                if (file.eof() && follow) { // Last line without its newline yet, keep it until the rest arrives
+                    partial += line;
+                    file.clear();
+                    this_thread::sleep_for(chrono::milliseconds(50));
+                    continue;
+                }
+                readerIdle.store(false);
+                line = partial + line;
+                partial.clear();
+                if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+                if (line.empty() || line.compare(0, 9, "VehicleID") == 0) continue; // Blank line or header
+
+                TripRequest trip;
+                string departure, priority;
+                istringstream fields(line);
+                getline(fields, trip.ID, ',');
+                getline(fields, trip.start, ',');
+                getline(fields, trip.end, ',');
+                getline(fields, departure, ',');
+                getline(fields, priority, ',');
+                if (trip.ID.empty() || trip.start.empty() || trip.end.empty() || departure.empty()
+                    || departure.find_first_not_of("0123456789") != string::npos || departure.size() > 9) {
+                    malformed++;
+                    continue;
+                }
+                trip.departure = stoi(departure);
+                trip.priority = FleetStore::parsePriority(priority);
+                tripsRead++;
+
+                bool stalled = false;
+                while (!parsedTrips.tryPush(trip) && !stop.load()) { // Router is behind, wait for room
+                    if (!stalled) readerStalls++;
+                    stalled = true;
+                    this_thread::sleep_for(chrono::milliseconds(1));
                 }
             }
+            readerIdle.store(true);
+            readerDone.store(true);
+        });
+
+        thread router([&]() {
+            Distance* dist = new Distance[snap->numNodes > 0 ? snap->numNodes : 1];
+            int* predEdge = new int[snap->numNodes > 0 ? snap->numNodes : 1];
+            RelaxKernel kernel = selectRelaxKernel();
+            TripRequest trip;
+            while (!stop.load()) {
+                if (!parsedTrips.tryPop(trip)) {
+                    if (readerDone.load() && parsedTrips.sizeApprox() == 0) break;
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                    continue;
+                }
+                auto routeStart = chrono::high_resolution_clock::now();
+                int from = snapshotNodeIndex(snap, trip.start);
+                int to = snapshotNodeIndex(snap, trip.end);
+                trip.route = Route();
+                Distance d;
+                if (from != -1 && to != -1) cachedShortestRoute(getRouteCache(), snap, snap->version, from, to, dist, predEdge, kernel, trip.route, d);
+                routingNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::high_resolution_clock::now() - routeStart).count();
+                tripsRouted++;
+
+                bool stalled = false;
+                while (!routedTrips.tryPush(trip)) { // Simulation is behind, wait for room
+                    if (stop.load()) break;
+                    if (!stalled) routerStalls++;
+                    stalled = true;
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+            }
+            delete[] dist;
+            delete[] predEdge;
+            routerDone.store(true);
+        });
+
+        MinHeap<int> events(64); // (time, vehicle): the vehicle stands at streamed.position[vehicle] of its route
+        FleetStore streamed; // Vehicles of this run only, with node indices of snap; the fleet is left as it was
+        int routeCapacity = 16;
+        Route* routes = new Route[routeCapacity]; // Route of vehicle v is routes[v]
+        long long injected = 0, arrived = 0, unroutable = 0, duplicates = 0, late = 0;
+        int worstLateness = 0;
+        int clock = 0; // Current simulation second
+
+        auto report = [&]() {
+            cout << "[t=" << clock << "] read " << tripsRead.load() << ", routed " << tripsRouted.load()
+                 << ", injected " << injected << ", arrived " << arrived
+                 << ", queued " << parsedTrips.sizeApprox() << "/" << routedTrips.sizeApprox()
+                 << ", late " << late << endl;
+        };
 
-            if (u == -1) break; // If no such node, exit
+        while (true) {
+            TripRequest trip;
+            while (routedTrips.tryPop(trip)) { // Inject every trip the router finished
+                if (!trip.route.found()) {
+                    unroutable++;
+                    cerr << "No path found for vehicle " << trip.ID << endl;
+                    continue;
+                }
+                int v = fleet.find(trip.ID) != -1 ? -1 : streamed.add(trip.ID, trip.route.origin, trip.route.node(snap, trip.route.length),
+                                                                       static_cast<VehiclePriority>(trip.priority));
+                if (v == -1) { // Taken by the fleet or earlier in the stream
+                    duplicates++;
+                    cout << "Vehicle " << trip.ID << " already exists, trip skipped." << endl;
+                    continue;
+                }
+                if (v == routeCapacity) { // Double the route array when full, the routes move over
+                    Route* newRoutes = new Route[routeCapacity * 2];
+                    for (int i = 0; i < routeCapacity; i++) newRoutes[i] = move(routes[i]);
+                    delete[] routes;
+                    routes = newRoutes;
+                    routeCapacity *= 2;
+                }
+                routes[v] = move(trip.route);
 
-            visited[u] = true; // Mark this node as visited
+                int departure = trip.departure;
+                if (departure < clock) { // Routed after it should have left, so it leaves now
+                    late++;
+                    if (clock - departure > worstLateness) worstLateness = clock - departure;
+                    departure = clock;
+                }
+                streamed.position[v] = 0;
+                streamed.departureTime[v] = departure;
+                events.push(departure, v);
+                injected++;
+            }
 
-            for (int j = 0; j < numEdges; j++) { // Update distances for neighboring nodes
-                if (streets[j].from == &intersections[u] && streets[j].isActive) {
-                    int v = -1;
-                    for (int k = 0; k < numNodes; k++) {  // Find the neighboring node index
-                        if (streets[j].to == &intersections[k]) {
-                            v = k;
-                            break;
-                        }
-                    }
+            while (!events.empty() && events.keys[0] <= clock) { // Process every vehicle due by now
+                int time, v;
+                events.pop(time, v);
+                const Route& route = routes[v];
+                int p = streamed.position[v];
+                bool emergency = streamed.priority[v] == PRIORITY_HIGH;
+                if (p == 0) {
+                    cout << (emergency ? "Emergency Vehicle " : "Vehicle ") << streamed.idOf(v) << " departs from "
+                         << snap->nodes[route.origin].name << " at time " << time << " seconds." << endl;
+                } else {
+                    cout << (emergency ? "Emergency Vehicle " : "Vehicle ") << streamed.idOf(v) << " moves to "
+                         << snap->nodes[route.node(snap, p)].name << " at time " << time << " seconds." << endl;
+                }
+                if (p == route.length) {
+                    arrived++;
+                    cout << "Vehicle " << streamed.idOf(v) << " Destination Reached." << endl;
+                    continue;
+                }
 
-                    /* Relaxation step: update the distance
-                     if a shorter path is found*/
-                    if (v != -1 && !visited[v] && dist[u] + streets[j].weight < dist[v]) {
-                        dist[v] = dist[u] + streets[j].weight;
-                        predecessor[v] = u; // Update predecessor for path tracking
-                    }
+                int edge = route.edges[p];
+                int arrival_time = time + snap->weight[edge];
+                if (!emergency && !is_light_green(snap, edge, arrival_time)) { // Emergency vehicles don't wait at signals
+                    arrival_time += calculate_wait_time(snap, edge, arrival_time);
                 }
+                streamed.position[v] = p + 1;
+                streamed.departureTime[v] = arrival_time;
+                events.push(arrival_time, v);
             }
+
+            if (routerDone.load() && routedTrips.sizeApprox() == 0 && events.empty()) break; // Stream used up, everyone arrived
+            if (clock >= max_simulation_time) break;
+            if (speed == 0 && !(readerIdle.load() && injected + unroutable + duplicates == tripsRead.load())) {
+                this_thread::sleep_for(chrono::milliseconds(1)); // As fast as possible, but only once every trip read so far is injected
+                continue;
+            }
+            if (clock > 0 && clock % 30 == 0) report();
+            clock++;
+            if (speed > 0) this_thread::sleep_for(chrono::milliseconds(1000 / speed));
         }
-        // If the destination node is not reachable
-        if (dist[endIdx] == INF) {
-            delete[] dist;
-            delete[] visited;
-            delete[] predecessor;
-            pathLength = 0;
-            return nullptr;
+
+        stop.store(true);
+        reader.join();
+        router.join();
+        delete[] routes; // Trips still queued free their routes with the queues
+        unpinSnapshot(readerSlot);
+
+        report();
+        cout << "Trips read: " << tripsRead.load() << " (malformed lines: " << malformed.load() << ")" << endl;
+        cout << "Trips routed: " << tripsRouted.load() << ", average routing time: "
+             << (tripsRouted.load() > 0 ? routingNanos.load() / 1000.0 / tripsRouted.load() : 0.0) << " us" << endl;
+        displayRouteCacheStats();
+        cout << "Vehicles injected: " << injected << ", arrived: " << arrived << ", still travelling: " << injected - arrived
+             << ", unroutable: " << unroutable << ", duplicate IDs: " << duplicates << endl;
+        cout << "Back-pressure: reader waited on a full queue " << readerStalls.load() << " times, router "
+             << routerStalls.load() << " times; queue high-water marks " << parsedTrips.highWater.load() << " and "
+             << routedTrips.highWater.load() << " of " << QUEUE_SIZE << endl;
+        cout << "Late departures: " << late << " trips were routed after their departure time";
+        if (late > 0) cout << " (worst by " << worstLateness << " seconds)";
+        cout << endl;
+        cout << "Streaming simulation complete." << endl;
+    }
+
+    bool scenarioRoutable(const int* snapshotNode, int v) { // Both ends of the vehicle's trip are in the snapshot
+        return fleet.origin[v] != -1 && snapshotNode[fleet.origin[v]] != -1 && snapshotNode[fleet.destination[v]] != -1;
+    }
+
+    /* Random closures, demand and emergency dispatches of one scenario, all
+     drawn from its seed so the same seed always builds the same scenario*/
+    void buildScenario(ScenarioView& view, unsigned int seed, int maxClosures, int maxDispatches) {
+        const int DEPARTURE_WINDOW = 300; // Extra trips leave within the first five minutes
+        const GraphSnapshot* snap = view.base;
+        XorShiftRandom random(seed * 2654435761u + 0x9e3779b9u); // Spread nearby seeds apart
+        view.reset();
+
+        int closures = random.below(maxClosures + 1);
+        for (int c = 0; c < closures && snap->numEdges > 0; c++) {
+            int slot = random.below(snap->numEdges);
+            if (view.weights()[slot] != ROUTE_BLOCKED) view.closeRoad(slot); // Already closed roads aren't counted twice
+        }
+
+        view.demandScale = 0.5 + 1.5 * random.uniform(); // Between half and twice the usual demand
+        int wholeCopies = static_cast<int>(view.demandScale);
+        double extraShare = view.demandScale - wholeCopies;
+        for (int v = 0; v < fleet.size; v++) {
+            if (!scenarioRoutable(view.snapshotNode, v) || fleet.priority[v] == PRIORITY_HIGH) continue; // Scale the normal traffic only
+            int copies = wholeCopies + (random.uniform() < extraShare ? 1 : 0);
+            for (int c = 0; c < copies; c++) view.addTrip(v, c == 0 ? 0 : random.below(DEPARTURE_WINDOW));
         }
-        pathLength = dist[endIdx]; // Set the shortest path length
-        /* Calculate the path length by
-         backtracking from the destination*/
-        int tempPathLength = 0;
-        int currIdx = endIdx;
-        while (currIdx != -1) {
-            tempPathLength++;
-            currIdx = predecessor[currIdx];
+        for (int v = 0; v < fleet.size; v++) { // Emergency vehicles of the fleet always run
+            if (scenarioRoutable(view.snapshotNode, v) && fleet.priority[v] == PRIORITY_HIGH) view.addTrip(v, 0);
         }
 
-        // Create a path array and backtrack to fill it
-        Nodes** path = new Nodes*[tempPathLength + 1];
-        currIdx = endIdx;
-        for (int i = tempPathLength - 1; i >= 0; i--) {
-            path[i] = &intersections[currIdx]; // Add node to path
-            currIdx = predecessor[currIdx]; // Move to the previous node
+        int dispatches = snap->numNodes > 0 ? random.below(maxDispatches + 1) : 0;
+        for (int d = 0; d < dispatches; d++) {
+            view.dispatchFrom[d] = random.below(snap->numNodes);
+            view.dispatchTo[d] = random.below(snap->numNodes);
+            view.dispatchDeparture[d] = random.below(DEPARTURE_WINDOW);
         }
-        path[tempPathLength] = nullptr; // Null-terminate the path
+        view.numDispatched = dispatches;
+    }
 
-        // Free memory
+    /* Base network route of every fleet vehicle, not found when it has none.
+     One search per origin, done once and shared by all scenarios of a run*/
+    Route* scenarioBaseRoutes(const GraphSnapshot* snap, const int* snapshotNode, RelaxKernel kernel) {
+        Route* routes = new Route[fleet.size > 0 ? fleet.size : 1];
+        int* byOrigin = new int[fleet.size > 0 ? fleet.size : 1];
+        int count = 0;
+        for (int v = 0; v < fleet.size; v++) {
+            if (scenarioRoutable(snapshotNode, v)) byOrigin[count++] = v;
+        }
+        sort(byOrigin, byOrigin + count, [&](int a, int b) { return snapshotNode[fleet.origin[a]] < snapshotNode[fleet.origin[b]]; });
+
+        Distance* dist = new Distance[snap->numNodes + 1];
+        int* predEdge = new int[snap->numNodes + 1];
+        for (int k = 0; k < count;) {
+            int o = snapshotNode[fleet.origin[byOrigin[k]]];
+            snapshotDijkstra(snap, o, dist, predEdge, kernel);
+            for (; k < count && snapshotNode[fleet.origin[byOrigin[k]]] == o; k++) {
+                int v = byOrigin[k];
+                int to = snapshotNode[fleet.destination[v]];
+                if (dist[to] != ROUTE_INF) routes[v] = routeFromPredecessors(snap, o, to, predEdge);
+            }
+        }
         delete[] dist;
-        delete[] visited;
-        delete[] predecessor;
+        delete[] predEdge;
+        delete[] byOrigin;
+        return routes;
+    }
 
-        return path; // Return the shortest path
+    /* Travel time of a route on empty roads, leaving at departure and waiting
+     at red lights unless it is an emergency vehicle*/
+    long long scenarioFreeFlowTime(const GraphSnapshot* snap, const int* edges, int hops, int departure, bool emergency) {
+        long long time = departure;
+        for (int h = 0; h < hops; h++) {
+            time += snap->weight[edges[h]];
+            if (!emergency && !is_light_green(snap, edges[h], time)) time += calculate_wait_time(snap, edges[h], time);
+        }
+        return time - departure;
     }
 
-    void displayCongestion() {
-        /* Loop through each road 
-        and display the vehicle count*/
-        for (int i = 0; i < numEdges; i++) {
-            int index = hashFunction(streets[i].from->name, streets[i].to->name);
-            cout << "Road " << streets[i].from->name << "-" << streets[i].to->name << ": "
-                 << vehicleCounts[index] << " vehicles";
-            // Check if the road is congested
-            if (isCongested(streets[i].from->name, streets[i].to->name)) {
-                cout << " (Congested)"; // Mark as congested if true
+    /* Routes every trip of the view around its closures and drives them all
+     through the queue model on queues of their own, so more demand means
+     longer queues and more spillback. A trip's delay is its travel time there
+     over the time of its base route on empty roads. Trips are grouped by
+     origin, so one search per origin serves all of its trips; the base routes
+     of fleet vehicles come from scenarioBaseRoutes and only origins with
+     dispatches need a base search. Work arrays hold numNodes + 1 entries,
+     byOrigin numTrips + numDispatched + numNodes + 1*/
+    void runScenario(const ScenarioView& view, const Route* baseRoutes, ScenarioResult& result, RelaxKernel kernel, Distance* dist,
+                     int* predEdge, Distance* baseDist, int* basePredEdge, int* byOrigin) {
+        const int TIME_LIMIT = 3600; // Trips still on the road an hour in count as stuck
+        const GraphSnapshot* snap = view.base;
+        int n = snap->numNodes;
+        int total = view.numTrips + view.numDispatched;
+        result.numClosed = view.numClosed;
+        result.demandScale = view.demandScale;
+
+        /* Counting sort of the trips by origin: trips of origin o are
+         byOrigin[start[o] .. start[o + 1] - 1], dispatches numbered after the trips*/
+        int* start = byOrigin + total;
+        for (int o = 0; o <= n; o++) start[o] = 0;
+        for (int t = 0; t < total; t++) {
+            start[(t < view.numTrips ? view.snapshotNode[fleet.origin[view.tripVehicle[t]]] : view.dispatchFrom[t - view.numTrips]) + 1]++;
+        }
+        for (int o = 0; o < n; o++) start[o + 1] += start[o];
+        for (int t = 0; t < total; t++) {
+            int o = t < view.numTrips ? view.snapshotNode[fleet.origin[view.tripVehicle[t]]] : view.dispatchFrom[t - view.numTrips];
+            byOrigin[start[o]++] = t;
+        }
+        for (int o = n; o > 0; o--) start[o] = start[o - 1]; // Undo the shift from filling
+        start[0] = 0;
+
+        /* Queue vehicle k is trip byOrigin[k]. Trips without a route get no
+         roads and never enter the queues*/
+        int size = total > 0 ? total : 1;
+        int* hopStart = new int[total + 1];
+        int* hopSlot = new int[16];
+        int numHops = 0, hopCapacity = 16;
+        int* departure = new int[size];
+        long long* baseTime = new long long[size];
+        unsigned char* priority = new unsigned char[size];
+        int* driving = new int[size]; // Queue vehicles that have somewhere to go
+        int numDriving = 0;
+        auto append = [&](int slot) {
+            if (numHops == hopCapacity) { // Double hopSlot when full
+                int* grown = new int[hopCapacity * 2];
+                for (int i = 0; i < numHops; i++) grown[i] = hopSlot[i];
+                delete[] hopSlot;
+                hopSlot = grown;
+                hopCapacity *= 2;
+            }
+            hopSlot[numHops++] = slot;
+        };
+
+        for (int o = 0; o < n; o++) {
+            if (start[o] == start[o + 1]) continue;
+            if (byOrigin[start[o + 1] - 1] >= view.numTrips) snapshotDijkstra(snap, o, baseDist, basePredEdge, kernel); // Dispatches sort last
+            if (view.routeWeight != nullptr) snapshotDijkstra(snap, o, dist, predEdge, kernel, -1, view.routeWeight);
+            const Distance* scenarioDist = view.routeWeight != nullptr ? dist : baseDist;
+            const int* scenarioPred = view.routeWeight != nullptr ? predEdge : basePredEdge;
+
+            for (int k = start[o]; k < start[o + 1]; k++) {
+                int t = byOrigin[k];
+                bool dispatched = t >= view.numTrips;
+                int to = dispatched ? view.dispatchTo[t - view.numTrips] : view.snapshotNode[fleet.destination[view.tripVehicle[t]]];
+                departure[k] = dispatched ? view.dispatchDeparture[t - view.numTrips] : view.tripDeparture[t];
+                priority[k] = dispatched ? static_cast<unsigned char>(PRIORITY_HIGH) : fleet.priority[view.tripVehicle[t]];
+                hopStart[k] = numHops;
+                if (dispatched) {
+                    if (baseDist[to] == ROUTE_INF) {
+                        result.baseUnroutable++;
+                        continue;
+                    }
+                    Route base = routeFromPredecessors(snap, o, to, basePredEdge);
+                    baseTime[k] = scenarioFreeFlowTime(snap, base.edges, base.length, departure[k], true);
+                } else {
+                    const Route& base = baseRoutes[view.tripVehicle[t]];
+                    if (!base.found()) {
+                        result.baseUnroutable++;
+                        continue;
+                    }
+                    baseTime[k] = scenarioFreeFlowTime(snap, base.edges, base.length, departure[k], priority[k] == PRIORITY_HIGH);
+                }
+                result.trips++;
+
+                if (view.routeWeight == nullptr && !dispatched) { // Nothing closed, the trip keeps its base route
+                    const Route& base = baseRoutes[view.tripVehicle[t]];
+                    for (int h = 0; h < base.length; h++) append(base.edges[h]);
+                } else {
+                    if (scenarioDist[to] == ROUTE_INF) {
+                        result.unreachable++;
+                        continue;
+                    }
+                    for (int node = to; node != o; node = snap->tail[scenarioPred[node]]) append(scenarioPred[node]);
+                    reverse(hopSlot + hopStart[k], hopSlot + numHops);
+                }
+                if (numHops == hopStart[k]) { // Already at its destination
+                    if (priority[k] == PRIORITY_HIGH) result.emergencyTrips++;
+                    continue;
+                }
+                driving[numDriving++] = k;
             }
-            cout << endl;
         }
+        hopStart[total] = numHops;
+
+        int* position = new int[size];
+        int* readyTime = new int[size];
+        int* pending = new int[size];
+        int* onRoad = new int[size]; // Queue vehicles that left and haven't arrived, in any order
+        int numOnRoad = 0;
+        for (int k = 0; k < total; k++) {
+            position[k] = -1;
+            readyTime[k] = 0;
+        }
+        sort(driving, driving + numDriving, [&](int a, int b) { // Departure order, ties by queue vehicle
+            return departure[a] != departure[b] ? departure[a] < departure[b] : a < b;
+        });
+
+        RoadQueues queues(snap->storage, snap->numEdges);
+        QueueFleet q;
+        q.size = total;
+        q.hopStart = hopStart;
+        q.hopSlot = hopSlot;
+        q.position = position;
+        q.readyTime = readyTime;
+        q.priority = priority;
+        q.pending = pending;
+        q.numPending = 0;
+        q.dirty = nullptr;
+        q.dirtyRoad = nullptr;
+        q.occupancy = nullptr;
+        q.occupancySlot = nullptr;
+        q.monitor = nullptr;
+
+        QueueStats stats;
+        int departed = 0;
+        for (int now = 0; (departed < numDriving || numOnRoad > 0) && now < TIME_LIMIT; now++) {
+            for (; departed < numDriving && departure[driving[departed]] <= now; departed++) {
+                q.pending[q.numPending++] = driving[departed];
+                onRoad[numOnRoad++] = driving[departed];
+            }
+            queueTick(snap, queues, q, now, stats, false);
+            int kept = 0;
+            for (int i = 0; i < numOnRoad; i++) {
+                int k = onRoad[i];
+                if (position[k] < hopStart[k + 1] - hopStart[k]) {
+                    onRoad[kept++] = k;
+                    continue;
+                }
+                long long time = now - departure[k];
+                long long delay = time - baseTime[k]; // Can be negative when the detour happens to catch green lights
+                result.totalDelay += delay;
+                if (delay > result.maxDelay) result.maxDelay = static_cast<int>(delay);
+                if (priority[k] == PRIORITY_HIGH) {
+                    result.emergencyTrips++;
+                    result.emergencyTime += time;
+                }
+            }
+            numOnRoad = kept;
+        }
+        result.stuck = numOnRoad + numDriving - departed;
+
+        delete[] hopStart;
+        delete[] hopSlot;
+        delete[] departure;
+        delete[] baseTime;
+        delete[] priority;
+        delete[] driving;
+        delete[] position;
+        delete[] readyTime;
+        delete[] pending;
+        delete[] onRoad;
     }
 
-    void blockRoad(const string& fromName, const string& toName) {
-        int index = findEdgeIndex(fromName, toName); // Find the index of the start and end nodes
-        if (index != -1) {
-            streets[index].isActive = false; // Set road as inactive
-            cout << "Road from " << fromName << " to " << toName << " has been closed." << endl;
-        } else {
-            cout << "Edge not found." << endl; // If no such road, show error
+    /* Runs numScenarios random scenarios across numThreads threads. Scenario s
+     uses seed baseSeed + s, and reproduceScenario rebuilds any of them from
+     its seed alone*/
+    void runScenarios(int numScenarios, unsigned int baseSeed, int numThreads, int maxClosures, int maxDispatches) {
+        if (numScenarios <= 0 || numThreads <= 0 || maxClosures < 0 || maxDispatches < 0) {
+            cout << "Invalid scenario settings." << endl;
+            return;
+        }
+        if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int n = snap->numNodes;
+        ScenarioResult* results = new ScenarioResult[numScenarios];
+        atomic<int> nextScenario(0);
+        RelaxKernel kernel = selectRelaxKernel();
+        int* snapshotNode = snapshotNodeMap(snap); // Trips use the live numbering, the scenarios route on snap
+        auto startTime = chrono::high_resolution_clock::now();
+        Route* baseRoutes = scenarioBaseRoutes(snap, snapshotNode, kernel);
+
+        auto worker = [&]() {
+            ScenarioView view(snap, snapshotNode, maxClosures, maxDispatches);
+            Distance* dist = new Distance[n + 1];
+            int* predEdge = new int[n + 1];
+            Distance* baseDist = new Distance[n + 1];
+            int* basePredEdge = new int[n + 1];
+            int* byOrigin = nullptr;
+            int byOriginSize = 0;
+            for (int s = nextScenario.fetch_add(1); s < numScenarios; s = nextScenario.fetch_add(1)) {
+                results[s].seed = baseSeed + s;
+                buildScenario(view, results[s].seed, maxClosures, maxDispatches);
+                int needed = view.numTrips + view.numDispatched + n + 1;
+                if (needed > byOriginSize) {
+                    delete[] byOrigin;
+                    byOrigin = new int[needed];
+                    byOriginSize = needed;
+                }
+                runScenario(view, baseRoutes, results[s], kernel, dist, predEdge, baseDist, basePredEdge, byOrigin);
+            }
+            delete[] dist;
+            delete[] predEdge;
+            delete[] baseDist;
+            delete[] basePredEdge;
+            delete[] byOrigin;
+        };
+
+        thread* pool = new thread[numThreads];
+        for (int t = 0; t < numThreads; t++) pool[t] = thread(worker);
+        for (int t = 0; t < numThreads; t++) pool[t].join();
+        delete[] pool;
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - startTime;
+        delete[] baseRoutes;
+        delete[] snapshotNode;
+        unpinSnapshot(readerSlot);
+
+        long long trips = 0, unreachable = 0, stuck = 0, totalDelay = 0, emergencyTrips = 0, emergencyTime = 0;
+        int scenariosCutOff = 0, worstDelay = 0;
+        double* meanDelays = new double[numScenarios];
+        int* order = new int[numScenarios];
+        for (int s = 0; s < numScenarios; s++) {
+            trips += results[s].trips;
+            unreachable += results[s].unreachable;
+            stuck += results[s].stuck;
+            totalDelay += results[s].totalDelay;
+            emergencyTrips += results[s].emergencyTrips;
+            emergencyTime += results[s].emergencyTime;
+            if (results[s].unreachable > 0) scenariosCutOff++;
+            if (results[s].maxDelay > worstDelay) worstDelay = results[s].maxDelay;
+            meanDelays[s] = results[s].meanDelay();
+            order[s] = s;
+        }
+        sort(meanDelays, meanDelays + numScenarios);
+        sort(order, order + numScenarios, [&](int a, int b) { // Worst scenarios first, ties by seed
+            if (results[a].meanDelay() != results[b].meanDelay()) return results[a].meanDelay() > results[b].meanDelay();
+            return a < b;
+        });
+
+        cout << numScenarios << " scenarios on " << numThreads << " threads in " << elapsed.count() << " s ("
+             << numScenarios / (elapsed.count() > 0 ? elapsed.count() : 1e-9) << " scenarios/s)" << endl;
+        cout << "Trips: " << trips << ", cut off by closures: " << unreachable << " ("
+             << (trips > 0 ? 100.0 * unreachable / trips : 0.0) << "%), in " << scenariosCutOff << " scenarios, stuck in traffic: " << stuck << endl;
+        long long arriving = trips - unreachable - stuck;
+        cout << "Delay per arriving trip: mean " << (arriving > 0 ? static_cast<double>(totalDelay) / arriving : 0.0)
+             << " s, scenario median " << meanDelays[numScenarios / 2] << " s, scenario p95 "
+             << meanDelays[(numScenarios * 95) / 100 < numScenarios ? (numScenarios * 95) / 100 : numScenarios - 1]
+             << " s, worst single trip " << worstDelay << " s" << endl;
+        if (emergencyTrips > 0) {
+            cout << "Emergency vehicles: " << emergencyTrips << " trips, mean travel time "
+                 << static_cast<double>(emergencyTime) / emergencyTrips << " s" << endl;
+        }
+        cout << "Worst scenarios (reproduce with their seed):" << endl;
+        for (int k = 0; k < numScenarios && k < 5; k++) {
+            const ScenarioResult& r = results[order[k]];
+            cout << "  seed " << r.seed << ": " << r.numClosed << " closures, demand x" << r.demandScale << ", mean delay "
+                 << r.meanDelay() << " s, " << r.unreachable << " of " << r.trips << " trips cut off" << endl;
         }
+
+        delete[] results;
+        delete[] meanDelays;
+        delete[] order;
     }
 
-    void reopenRoad(const string& fromName, const string& toName) {
-        int index = findEdgeIndex(fromName, toName); // Find the index of the road to reopen
-        if (index != -1) {
-            streets[index].isActive = true; // Set road as active
-            cout << "Road from " << fromName << " to " << toName << " has been reopened." << endl;
-        } else {
-            cout << "Edge not found." << endl; // If no such road, show error
+    void reproduceScenario(unsigned int seed, int maxClosures, int maxDispatches) { // One scenario in detail
+        if (maxClosures < 0 || maxDispatches < 0) {
+            cout << "Invalid scenario settings." << endl;
+            return;
+        }
+        const GraphSnapshot* snap;
+        int readerSlot = pinSnapshot(snap);
+        int n = snap->numNodes;
+        int* snapshotNode = snapshotNodeMap(snap);
+        ScenarioView view(snap, snapshotNode, maxClosures, maxDispatches);
+        buildScenario(view, seed, maxClosures, maxDispatches);
+
+        cout << "Scenario " << seed << ": demand x" << view.demandScale << ", " << view.numTrips << " trips" << endl;
+        for (int c = 0; c < view.numClosed; c++) {
+            int slot = view.closedEdges[c];
+            cout << "  Closed road " << snap->nodes[snap->tail[slot]].name << " -> " << snap->nodes[snap->head[slot]].name << endl;
         }
+        for (int d = 0; d < view.numDispatched; d++) {
+            cout << "  Emergency dispatch " << snap->nodes[view.dispatchFrom[d]].name << " -> "
+                 << snap->nodes[view.dispatchTo[d]].name << " at time " << view.dispatchDeparture[d] << endl;
+        }
+
+        ScenarioResult result;
+        result.seed = seed;
+        RelaxKernel kernel = selectRelaxKernel();
+        Route* baseRoutes = scenarioBaseRoutes(snap, snapshotNode, kernel);
+        Distance* dist = new Distance[n + 1];
+        int* predEdge = new int[n + 1];
+        Distance* baseDist = new Distance[n + 1];
+        int* basePredEdge = new int[n + 1];
+        int* byOrigin = new int[view.numTrips + view.numDispatched + n + 1];
+        runScenario(view, baseRoutes, result, kernel, dist, predEdge, baseDist, basePredEdge, byOrigin);
+        cout << "Mean delay " << result.meanDelay() << " s, worst trip " << result.maxDelay << " s, "
+             << result.unreachable << " of " << result.trips << " trips cut off, " << result.stuck << " stuck in traffic, "
+             << result.baseUnroutable << " trips without a route even before the closures" << endl;
+
+        delete[] baseRoutes;
+        delete[] dist;
+        delete[] predEdge;
+        delete[] baseDist;
+        delete[] basePredEdge;
+        delete[] byOrigin;
+        delete[] snapshotNode;
+        unpinSnapshot(readerSlot);
     }
+};
 
-    bool isEdgeActive(const string& fromName, const string& toName) {
-        int index = findEdgeIndex(fromName, toName);  // Find the index of the road to reopen
-        if (index != -1) {
-            return streets[index].isActive; // Return true if the road is active
+#ifdef HAVE_UNIX_SOCKETS
+/* Routing service protocol. Every message is a frame of 32-bit ints in the
+ machine's byte order, starting with the number of bytes that follow.
+   Request:  size, id, type, body
+   Response: size, id, status, body
+ The id is chosen by the client and copied into the response. Responses of one
+ connection can arrive in any order.
+   SERVICE_NODES     ()                      -> count, then per node its name length and name bytes
+   SERVICE_ROUTE     (from, to)              -> distance, roads, then the roads + 1 node indices
+   SERVICE_MATRIX    (n, m, n sources, m targets) -> n * m distances, -1 when unreachable
+   SERVICE_CLOSURE   (from, to, open)        -> (), closes the road for open = 0, reopens it otherwise
+   SERVICE_STATS     ()                      -> requests served, p50 and p99 latency (us), batches
+   SERVICE_SHUTDOWN  ()                      -> (), then the service stops
+ Nodes are given by index (the order of SERVICE_NODES)*/
+const int SERVICE_NODES = 0;
+const int SERVICE_ROUTE = 1;
+const int SERVICE_MATRIX = 2;
+const int SERVICE_CLOSURE = 3;
+const int SERVICE_STATS = 4;
+const int SERVICE_SHUTDOWN = 5;
+const int SERVICE_OK = 0;          // Response statuses
+const int SERVICE_NOT_FOUND = 1;   // No route, or no such road
+const int SERVICE_BAD_REQUEST = 2; // Unknown type, wrong body size or a node out of range
+const int SERVICE_MAX_FRAME = 16 << 20; // Bytes, a larger frame closes the connection
+const int SERVICE_MAX_BATCH = 64;       // Requests a worker takes off the queue at once
+const int SERVICE_QUEUE_SIZE = 4096;    // Readers wait when this many requests are queued
+
+volatile sig_atomic_t serviceSignalled = 0; // Set by SIGINT/SIGTERM
+
+void onServiceSignal(int) {
+    serviceSignalled = 1;
+}
+
+bool readFully(int fd, void* buffer, int count) {
+    char* bytes = static_cast<char*>(buffer);
+    while (count > 0) {
+        ssize_t got = read(fd, bytes, count);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false; // Closed or failed
+        bytes += got;
+        count -= static_cast<int>(got);
+    }
+    return true;
+}
+
+bool writeFully(int fd, const void* buffer, int count) {
+    const char* bytes = static_cast<const char*>(buffer);
+    while (count > 0) {
+        ssize_t put = write(fd, bytes, count);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+        bytes += put;
+        count -= static_cast<int>(put);
+    }
+    return true;
+}
+
+void beginFrame(ByteBuffer& frame, int id, int typeOrStatus) { // Size is filled in by endFrame
+    frame.clear();
+    int header[3] = {0, id, typeOrStatus};
+    frame.putInts(header, 3);
+}
+
+void endFrame(ByteBuffer& frame) {
+    int size = frame.size - static_cast<int>(sizeof(int));
+    memcpy(frame.data, &size, sizeof(int));
+}
+
+int percentile(int* values, int count, double q) { // Reorders values
+    if (count == 0) return 0;
+    int k = static_cast<int>(q * (count - 1) + 0.5);
+    nth_element(values, values + k, values + count);
+    return values[k];
+}
+
+struct ServiceConnection { // One client, read by its own thread and answered by the workers
+    int fd;
+    mutex writeMutex;  // Workers answering requests of this connection take turns
+    atomic<int> refs;  // The service plus every request not answered yet, the socket closes at 0
+    atomic<bool> done; // The reader has stopped
+    thread reader;
+
+    ServiceConnection(int f) : fd(f), refs(1), done(false) {}
+
+    ServiceConnection(const ServiceConnection&) = delete;
+    ServiceConnection& operator=(const ServiceConnection&) = delete;
+
+    void send(const ByteBuffer& frame) { // A client that went away just misses its answers
+        lock_guard<mutex> lock(writeMutex);
+        writeFully(fd, frame.data, frame.size);
+    }
+
+    void release() {
+        if (refs.fetch_sub(1) == 1) {
+            close(fd);
+            delete this;
         }
-        return false; // Return false if no such road is found.
     }
 };
 
-class Vehicles : public Graph {
-private:
-    VehiclesNode *vehicle;
-    int capacity;
-    int numVehicles;
+struct ServiceRequest {
+    ServiceConnection* connection;
+    int id;
+    int type;
+    int* body;
+    int bodyInts;
+    chrono::steady_clock::time_point arrival;
 
-    void IncreaseNumVehicles() {     // Increase the array size when it's full
-        VehiclesNode *NVehicles = new VehiclesNode[capacity + 5];
-        int i = 0;
-        while (i < capacity) {
-            NVehicles[i] = vehicle[i];
-            i++;
-        }
-        capacity += 5;
-        delete[] vehicle;
-        vehicle = NVehicles;
+    ServiceRequest(ServiceConnection* c, int i, int t, int n) : connection(c), id(i), type(t), body(new int[n > 0 ? n : 1]), bodyInts(n) {}
+
+    ~ServiceRequest() {
+        delete[] body;
     }
 
-public:
-    Vehicles() : Graph(), vehicle(new VehiclesNode[10]), capacity(10), numVehicles(0) {} // Constructor to initialize vehicle array with capacity 10
+    ServiceRequest(const ServiceRequest&) = delete;
+    ServiceRequest& operator=(const ServiceRequest&) = delete;
+};
 
-    ~Vehicles() {  // Destructor to cleaning up
-        delete[] vehicle;
+/* Bounded queue between the connection readers and the workers. A worker takes
+ everything queued, up to SERVICE_MAX_BATCH, in one go: under light load a
+ batch is a single request and waits for nothing, under heavy load the batches
+ grow by themselves*/
+struct ServiceQueue {
+    ServiceRequest** items;
+    int head;
+    int count;
+    bool closed;
+    mutex queueMutex;
+    condition_variable notEmpty;
+    condition_variable notFull;
+
+    ServiceQueue() : items(new ServiceRequest*[SERVICE_QUEUE_SIZE]), head(0), count(0), closed(false) {}
+
+    ~ServiceQueue() {
+        delete[] items;
+    }
+
+    ServiceQueue(const ServiceQueue&) = delete;
+    ServiceQueue& operator=(const ServiceQueue&) = delete;
+
+    bool push(ServiceRequest* request) { // False once the queue is closed
+        unique_lock<mutex> lock(queueMutex);
+        notFull.wait(lock, [&]() { return count < SERVICE_QUEUE_SIZE || closed; });
+        if (closed) return false;
+        items[(head + count) % SERVICE_QUEUE_SIZE] = request;
+        count++;
+        notEmpty.notify_one();
+        return true;
     }
-       
-    void createVehicles(const string& name, string& from_node, string& to_node, string priorityLevel) {  // Creating a new gari
-        Nodes* Start = findNode(from_node);
-        Nodes* End = findNode(to_node);
-        /* If either start or end node is not found,
-         show an error message*/
-        if (Start == nullptr || End == nullptr) { 
-            cout << "One or both Nodes not found!" << endl;
-            return;
-        }
 
-        if (numVehicles >= capacity) {
-            IncreaseNumVehicles();  // If vehicle array is full, increase its capacity
+    int popBatch(ServiceRequest** batch) { // 0 once the queue is closed and empty
+        unique_lock<mutex> lock(queueMutex);
+        notEmpty.wait(lock, [&]() { return count > 0 || closed; });
+        int taken = min(count, SERVICE_MAX_BATCH);
+        for (int i = 0; i < taken; i++) {
+            batch[i] = items[head];
+            head = (head + 1) % SERVICE_QUEUE_SIZE;
         }
+        count -= taken;
+        notFull.notify_all();
+        return taken;
+    }
 
-        VehiclesNode NewVehicle;  // Create a new vehicle and set its properties
-        NewVehicle.ID = name;
-        NewVehicle.edge = new Edges(Start, End, 0);
-        NewVehicle.priorityLevel = priorityLevel;
-        vehicle[numVehicles++] = NewVehicle;
+    void close() {
+        lock_guard<mutex> lock(queueMutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
     }
+};
 
-        void Input_Vehicle() {  // Create a new vehicle and set its properties
-        string id, Start, End, p_level;
-        while (true) {
-            if (numVehicles == capacity) {
-                IncreaseNumVehicles();
-            }
+struct LatencyLog { // The latest LATENCY_SAMPLES request latencies in microseconds
+    static const int LATENCY_SAMPLES = 1 << 16;
+    int* samples;
+    long long served;
+    long long batches;
+    mutex logMutex;
 
-            cout << "Enter Vehicle ID, Start Intersection, End Intersection and Priority_Level : "; 
-            cin >> id >> Start >> End >> p_level;   // Create a new vehicle and set its properties
-            if (id == "-1") {
-                break; 
-            }
-            createVehicles(id, Start, End, p_level); // Default priority level is "Low"
-            if(p_level != "High"){
-                ofstream file("vehicles.csv", std::ios::app);
-                file << id << "," << Start << "," << End << endl; 
-                file.close();
-            }
-            else{
-                ofstream file1("emergency_vehicles.csv", std::ios::app);
-                file1 << id << "," << Start << "," << End << "," << p_level << endl; 
-                file1.close();
-            }
-            
-        }
+    LatencyLog() : samples(new int[LATENCY_SAMPLES]), served(0), batches(0) {}
+
+    ~LatencyLog() {
+        delete[] samples;
     }
-    void calcaulate_route() {   // Calculate the shortest route for each vehicle
-        int distance;
-        for (int i = 0; i < numVehicles; i++) {
-            cout << "Vehicle with id " << vehicle[i].ID << endl;
 
-            /*Use Dijkstra's algorithm
-             to find the path*/ 
-            Nodes** path = dijkstra(vehicle[i].edge->from->name, vehicle[i].edge->to->name, distance);
+    LatencyLog(const LatencyLog&) = delete;
+    LatencyLog& operator=(const LatencyLog&) = delete;
 
-            if (path == nullptr) {
-                cout << "Node is Unreachable" << endl;
-            } 
-            else {     // Display the path and the distance
-                cout << "Path: ";
-                int j = 0;
-                while (path[j] != nullptr) {
-                    cout << path[j]->name;
-                    j++;
-                    if (path[j] != nullptr) {
-                        cout << " -> ";
-                    }
-                }
-                cout << endl;
-                cout << "Shortest Distance: " << distance << endl;
-                cout << endl;
+    void record(const int* latencies, int count) { // One batch
+        lock_guard<mutex> lock(logMutex);
+        for (int i = 0; i < count; i++) samples[(served + i) % LATENCY_SAMPLES] = latencies[i];
+        served += count;
+        batches++;
+    }
 
-                delete[] path;  // Clean up the allocated path array
-            }
+    void summary(long long& totalServed, long long& totalBatches, int& p50, int& p99) {
+        int* copy = new int[LATENCY_SAMPLES];
+        int count;
+        {
+            lock_guard<mutex> lock(logMutex);
+            totalServed = served;
+            totalBatches = batches;
+            count = static_cast<int>(min<long long>(served, LATENCY_SAMPLES));
+            memcpy(copy, samples, count * sizeof(int));
         }
+        p50 = percentile(copy, count, 0.50);
+        p99 = percentile(copy, count, 0.99);
+        delete[] copy;
     }
+};
 
-    void vehicles_csv() {   // Read vehicle data from CSV files
-        ifstream file("vehicles.csv");
-        string header;
-        file >> header;
-        string id, start, end;
-        string priorityLevel;
-
-        while (file.good()) {  // Process general vehicle data
-            getline(file, id, ',');
-            getline(file, start, ',');
-            file >> end;
-            priorityLevel = "Low";
-            file.ignore(__LONG_MAX__, '\n');
-            if (!start.empty() && !end.empty() && !id.empty()) {
-                createVehicles(id, start, end, priorityLevel);
+/* Keeps the loaded graph resident and answers route, matrix and closure
+ requests from other processes over a Unix domain socket. Every connection
+ has a reader thread that queues its requests; numWorkers workers take them
+ off in batches. A batch applies its closures first, then pins one snapshot
+ for all its reads, and route requests sharing a start share one search*/
+struct RoutingService {
+    Vehicles& vehicles;
+    int numWorkers;
+    ServiceQueue queue;
+    LatencyLog latency;
+    atomic<bool> stopping;
+
+    RoutingService(Vehicles& v, int workers) : vehicles(v), numWorkers(workers > 0 ? min(workers, MAX_THREADS) : 1), stopping(false) {}
+
+    RoutingService(const RoutingService&) = delete;
+    RoutingService& operator=(const RoutingService&) = delete;
+
+    void readRequests(ServiceConnection* connection) {
+        while (!stopping) {
+            int header[3]; // Size, id, type
+            if (!readFully(connection->fd, header, sizeof(header))) break;
+            int bodyBytes = header[0] - 2 * static_cast<int>(sizeof(int));
+            if (bodyBytes < 0 || header[0] > SERVICE_MAX_FRAME || bodyBytes % static_cast<int>(sizeof(int)) != 0) break; // Not our protocol
+            ServiceRequest* request = new ServiceRequest(connection, header[1], header[2], bodyBytes / static_cast<int>(sizeof(int)));
+            if (!readFully(connection->fd, request->body, bodyBytes)) {
+                delete request;
+                break;
+            }
+            request->arrival = chrono::steady_clock::now();
+            connection->refs++;
+            if (!queue.push(request)) {
+                connection->release();
+                delete request;
+                break;
             }
         }
-        file.close();
+        connection->done = true;
+    }
 
-        ifstream file1("emergency_vehicles.csv");
-        file1 >> header;
+    bool validNode(const GraphSnapshot* snap, int node) {
+        return node >= 0 && node < snap->numNodes;
+    }
 
-        while (file1.good()) {  // Process emergency vehicle data
-            getline(file1, id, ',');
-            getline(file1, start, ',');
-            getline(file1, end, ',');
-            file1 >> priorityLevel;
-            file1.ignore(__LONG_MAX__, '\n');
-            if (!start.empty() && !end.empty() && !id.empty() && !priorityLevel.empty()) {
-                createVehicles(id, start, end, priorityLevel);
+    void answerRoutes(const GraphSnapshot* snap, ServiceRequest** batch, int* order, int numRoutes, RelaxKernel kernel,
+                      Distance* dist, int* predEdge, ByteBuffer& frame) {
+        RouteCache& cache = vehicles.getRouteCache();
+        int numValid = 0;
+        for (int k = 0; k < numRoutes; k++) { // Malformed requests are answered first, the rest sorted by start
+            ServiceRequest* request = batch[order[k]];
+            if (request->bodyInts == 2 && validNode(snap, request->body[0]) && validNode(snap, request->body[1])) {
+                order[numValid++] = order[k];
+                continue;
             }
+            beginFrame(frame, request->id, SERVICE_BAD_REQUEST);
+            endFrame(frame);
+            request->connection->send(frame);
+        }
+        numRoutes = numValid;
+        sort(order, order + numRoutes, [&](int a, int b) { return batch[a]->body[0] < batch[b]->body[0]; });
+        int searchedFrom = -1;
+        for (int k = 0; k < numRoutes; k++) {
+            ServiceRequest* request = batch[order[k]];
+            int src = request->body[0], dst = request->body[1];
+            Route route;
+            long long cost;
+            if (!cache.lookup(src, dst, ROUTE_CACHE_STATIC, snap->version, route, cost)) {
+                if (src != searchedFrom) { // One search for every start, to all nodes when several requests need it
+                    bool shared = k + 1 < numRoutes && batch[order[k + 1]]->body[0] == src;
+                    vehicles.snapshotDijkstra(snap, src, dist, predEdge, kernel, shared ? -1 : dst);
+                    searchedFrom = src;
+                }
+                cost = dist[dst] == ROUTE_INF ? -1 : dist[dst];
+                if (cost != -1) route = routeFromPredecessors(snap, src, dst, predEdge);
+                cache.insert(src, dst, ROUTE_CACHE_STATIC, snap->version, route, cost);
+            }
+            if (cost == -1) {
+                beginFrame(frame, request->id, SERVICE_NOT_FOUND);
+            } else {
+                beginFrame(frame, request->id, SERVICE_OK);
+                frame.putInt(static_cast<int>(cost));
+                frame.putInt(route.length);
+                for (int i = 0; i <= route.length; i++) frame.putInt(route.node(snap, i));
+            }
+            endFrame(frame);
+            request->connection->send(frame);
         }
-        file1.close();
     }
 
-    void displayVehicles() { // Display the list of all vehicles
-        if (numVehicles == 0) {
-            cout << "No vehicles available." << endl;
-            return;
-        }
-        cout << "Vehicles in the system:" << endl;
-        for (int i = 0; i < numVehicles; i++) {  // Loop through each vehicle and print its details
-            cout << "ID: " << vehicle[i].ID << ", Start: " << vehicle[i].edge->from->name
-                << ", End: " << vehicle[i].edge->to->name << ", Priority: " << vehicle[i].priorityLevel << endl;
+    void answer(const GraphSnapshot* snap, ServiceRequest* request, ByteBuffer& frame) { // Everything but routes and closures
+        const int* body = request->body;
+        if (request->type == SERVICE_NODES && request->bodyInts == 0) {
+            beginFrame(frame, request->id, SERVICE_OK);
+            frame.putInt(snap->numNodes);
+            for (int i = 0; i < snap->numNodes; i++) {
+                frame.putInt(static_cast<int>(snap->nodes[i].name.size()));
+                frame.append(snap->nodes[i].name.data(), static_cast<int>(snap->nodes[i].name.size()));
+            }
+        } else if (request->type == SERVICE_MATRIX && request->bodyInts >= 2 && body[0] > 0 && body[1] > 0 &&
+                   request->bodyInts == 2LL + body[0] + body[1] &&
+                   static_cast<long long>(body[0]) * body[1] <= SERVICE_MAX_FRAME / static_cast<int>(sizeof(int))) {
+            int numSources = body[0], numTargets = body[1];
+            bool valid = true;
+            for (int i = 0; i < numSources + numTargets; i++) valid = valid && validNode(snap, body[2 + i]);
+            if (!valid) {
+                beginFrame(frame, request->id, SERVICE_BAD_REQUEST);
+            } else {
+                Distance* matrix = new Distance[numSources * numTargets];
+                vehicles.distanceMatrix(snap, body + 2, numSources, body + 2 + numSources, numTargets, matrix, BACKEND_DIJKSTRA);
+                beginFrame(frame, request->id, SERVICE_OK);
+                for (int i = 0; i < numSources * numTargets; i++) { // Wire distances are int32, -1 when unreachable
+                    frame.putInt(matrix[i] == ROUTE_INF ? -1 : static_cast<int>(matrix[i]));
+                }
+                delete[] matrix;
+            }
+        } else if (request->type == SERVICE_STATS && request->bodyInts == 0) {
+            long long served, batches;
+            int p50, p99;
+            latency.summary(served, batches, p50, p99);
+            int stats[4] = {static_cast<int>(min<long long>(served, 0x7fffffff)), p50, p99,
+                            static_cast<int>(min<long long>(batches, 0x7fffffff))};
+            beginFrame(frame, request->id, SERVICE_OK);
+            frame.putInts(stats, 4);
+        } else if (request->type == SERVICE_SHUTDOWN && request->bodyInts == 0) {
+            beginFrame(frame, request->id, SERVICE_OK);
+            stopping = true;
+        } else {
+            beginFrame(frame, request->id, SERVICE_BAD_REQUEST);
         }
+        endFrame(frame);
+        request->connection->send(frame);
     }
-    /*Calculate the total travel
-     time for a vehicle along a path*/ 
-    int calculate_travel_time(Nodes** path, string start_name, string end_name, int red_duration) {
-        int total_time = 0;
-        int departure_time = 0;
 
-        for (int index = 0; path[index + 1] != nullptr; index++) {  // Traverse each segment of the path
-            Nodes* current_node = path[index];
-            Nodes* next_node = path[index + 1];
-            int edge_weight = get_edge_weight(current_node, next_node);
-            if (edge_weight == -1) return -1;
-
-            int travel_time = edge_weight;
-            int arrival_time = departure_time + travel_time;
+    void work() {
+        RelaxKernel kernel = selectRelaxKernel();
+        ServiceRequest* batch[SERVICE_MAX_BATCH];
+        int order[SERVICE_MAX_BATCH];
+        int latencies[SERVICE_MAX_BATCH];
+        ByteBuffer frame;
+        Distance* dist = nullptr;
+        int* predEdge = nullptr;
+        int capacity = 0;
+        int count;
+        while ((count = queue.popBatch(batch)) > 0) {
+            for (int i = 0; i < count; i++) { // Closures first, so the reads of the batch see them
+                ServiceRequest* request = batch[i];
+                if (request->type != SERVICE_CLOSURE) continue;
+                int status = SERVICE_BAD_REQUEST;
+                if (request->bodyInts == 3) {
+                    status = vehicles.setRoadActive(request->body[0], request->body[1], request->body[2] != 0) ? SERVICE_OK : SERVICE_NOT_FOUND;
+                }
+                beginFrame(frame, request->id, status);
+                endFrame(frame);
+                request->connection->send(frame);
+            }
 
-            if (!is_light_green(next_node, arrival_time, red_duration)) { // Check traffic light condition 
-                int wait_time = calculate_wait_time(next_node, arrival_time, red_duration);  //calculate waiting time
-                total_time += travel_time + wait_time;
-                departure_time = arrival_time + wait_time;
-            } 
-            else {
-                total_time += travel_time;
-                departure_time = arrival_time;
+            const GraphSnapshot* snap;
+            int readerSlot = vehicles.pinSnapshot(snap);
+            if (snap->numNodes > capacity) {
+                delete[] dist;
+                delete[] predEdge;
+                capacity = snap->numNodes;
+                dist = new Distance[capacity];
+                predEdge = new int[capacity];
+            }
+            int numRoutes = 0;
+            for (int i = 0; i < count; i++) {
+                if (batch[i]->type == SERVICE_ROUTE) order[numRoutes++] = i;
+                else if (batch[i]->type != SERVICE_CLOSURE) answer(snap, batch[i], frame);
+            }
+            answerRoutes(snap, batch, order, numRoutes, kernel, dist, predEdge, frame);
+            vehicles.unpinSnapshot(readerSlot);
+
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            for (int i = 0; i < count; i++) {
+                latencies[i] = static_cast<int>(chrono::duration_cast<chrono::microseconds>(now - batch[i]->arrival).count());
+                batch[i]->connection->release();
+                delete batch[i];
             }
+            latency.record(latencies, count);
         }
-        return total_time;
+        delete[] dist;
+        delete[] predEdge;
     }
 
-    int get_edge_weight(Nodes* from, Nodes* to) {   // Get the weight (time) of a road segment between two nodes
-        for (int i = 0; i < getnumEdges(); i++) {
-            if (getStreets(i).from == from && getStreets(i).to == to) {
-                return getStreets(i).weight;
-            }
-        }
-        return -1;
+    void report(long long& lastServed, chrono::steady_clock::time_point& lastReport) {
+        long long served, batches;
+        int p50, p99;
+        latency.summary(served, batches, p50, p99);
+        long long hits, misses, stale, evictions, cacheBytes;
+        int cached;
+        vehicles.getRouteCache().summary(hits, misses, stale, evictions, cached, cacheBytes);
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        chrono::duration<double> elapsed = now - lastReport;
+        cout << served << " requests served, " << (served - lastServed) / (elapsed.count() > 0 ? elapsed.count() : 1e-9)
+             << " per second, p50 " << p50 << " us, p99 " << p99 << " us, "
+             << (batches > 0 ? static_cast<double>(served) / batches : 0.0) << " requests per batch, route cache hit rate "
+             << (hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0) << "%" << endl;
+        lastServed = served;
+        lastReport = now;
     }
 
-    /* Check if the traffic light is green when 
-    a vehicle arrives at a node*/
-    bool is_light_green(Nodes* node, int arrival_time, int red_duration) {
-        if (node == nullptr) {
-            cerr << "Null node in is_light_green" << endl;
+    /* Serves until a SERVICE_SHUTDOWN request, SIGINT or SIGTERM. Returns
+     false when the socket can't be set up*/
+    bool run(const string& socketPath) {
+        const int REPORT_SECONDS = 5;
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            cerr << "Socket path too long: " << socketPath << endl;
             return false;
         }
-        int total_cycle = node->timing + red_duration;
-        int time_in_cycle = arrival_time % total_cycle;
-        return time_in_cycle < node->timing;
-    }
-    /* Calculate how long a vehicle
-     needs to wait for a green light*/
-    int calculate_wait_time(Nodes* node, int arrival_time, int red_duration) {
-        if (node == nullptr) {
-            cerr << "Null node in calculate_wait_time" << endl;
-            return 0;
-        }
-        int total_cycle = node->timing + red_duration;
-        int time_in_cycle = arrival_time % total_cycle;
-        if (time_in_cycle < node->timing) {
-            return 0;
-        } else {
-            return total_cycle - time_in_cycle;
+        strcpy(address.sun_path, socketPath.c_str());
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socketPath.c_str()); // Left behind by a service that didn't stop cleanly
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 128) != 0) {
+            cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+            if (listener >= 0) close(listener);
+            return false;
         }
-    }
-
-   void simulate() { 
-    int red_duration = 30; // Red light duration and maximum simulation time
-    int max_simulation_time = 300;
-
-    Nodes*** vehicle_paths = new Nodes**[numVehicles];  // Arrays to store the paths and their lengths for each vehicle
-    int* path_lengths = new int[numVehicles];
-
-    for (int i = 0; i < numVehicles; i++) { // Calculate paths for each vehicle
-        int distance;
-        Nodes** path = dijkstra(vehicle[i].edge->from->name, vehicle[i].edge->to->name, distance);
-
-        if (path == nullptr) {    // If no path is found, print an error and skip the vehicle
-            cerr << "No path found for vehicle " << vehicle[i].ID << endl;
-            vehicle_paths[i] = nullptr;
-            path_lengths[i] = 0;
-            continue;
+        signal(SIGPIPE, SIG_IGN); // Writing to a client that went away must not kill the service
+        signal(SIGINT, onServiceSignal);
+        signal(SIGTERM, onServiceSignal);
+
+        thread* workers = new thread[numWorkers];
+        for (int w = 0; w < numWorkers; w++) workers[w] = thread(&RoutingService::work, this);
+        cout << "Routing service listening on " << socketPath << " with " << numWorkers << " workers" << endl;
+
+        int connectionCapacity = 16, numConnections = 0;
+        ServiceConnection** connections = new ServiceConnection*[connectionCapacity];
+        long long lastServed = 0;
+        chrono::steady_clock::time_point lastReport = chrono::steady_clock::now();
+        while (!stopping && !serviceSignalled) {
+            pollfd waiting = {listener, POLLIN, 0};
+            if (poll(&waiting, 1, 200) > 0) { // Wake up now and then to notice a stop
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd >= 0) {
+                    if (numConnections == connectionCapacity) {
+                        connectionCapacity *= 2;
+                        ServiceConnection** grown = new ServiceConnection*[connectionCapacity];
+                        for (int i = 0; i < numConnections; i++) grown[i] = connections[i];
+                        delete[] connections;
+                        connections = grown;
+                    }
+                    ServiceConnection* connection = new ServiceConnection(fd);
+                    connection->reader = thread(&RoutingService::readRequests, this, connection);
+                    connections[numConnections++] = connection;
+                }
+            }
+            for (int i = 0; i < numConnections; i++) { // Let go of clients that hung up
+                if (connections[i]->done) {
+                    connections[i]->reader.join();
+                    connections[i]->release();
+                    connections[i--] = connections[--numConnections];
+                }
+            }
+            if (chrono::steady_clock::now() - lastReport >= chrono::seconds(REPORT_SECONDS)) report(lastServed, lastReport);
         }
 
-        int path_length = 0;  // Count the length of the path and copy it to vehicle_paths
-        while (path[path_length] != nullptr) {
-            path_length++;
-        }
-        vehicle_paths[i] = new Nodes*[path_length + 1];
-        for (int j = 0; j < path_length; j++) {
-            vehicle_paths[i][j] = path[j];
+        close(listener);
+        unlink(socketPath.c_str());
+        stopping = true;
+        for (int i = 0; i < numConnections; i++) {
+            shutdown(connections[i]->fd, SHUT_RD); // Wakes the reader, answers still go out
+            connections[i]->reader.join();
         }
-        vehicle_paths[i][path_length] = nullptr;
-        path_lengths[i] = path_length;
+        queue.close(); // The workers answer what is queued, then stop
+        for (int w = 0; w < numWorkers; w++) workers[w].join();
+        for (int i = 0; i < numConnections; i++) connections[i]->release();
+        delete[] connections;
+        delete[] workers;
+        report(lastServed, lastReport);
+        cout << "Routing service stopped." << endl;
+        return true;
+    }
+};
 
-        delete[] path;   // Free the original path array
+int connectService(const string& socketPath) { // Returns the socket, or -1
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, socketPath.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
     }
+    return fd;
+}
 
-    int* vehicle_positions = new int[numVehicles]; // Initialize vehicle positions and departure times
-    int* vehicle_departure_times = new int[numVehicles];
-    for (int i = 0; i < numVehicles; i++) {
-        vehicle_positions[i] = 0;
-        vehicle_departure_times[i] = 0;
+bool readResponse(int fd, int& id, int& status, ByteBuffer& body) { // One frame, body holds what follows the status
+    int header[3];
+    if (!readFully(fd, header, sizeof(header))) return false;
+    int bodyBytes = header[0] - 2 * static_cast<int>(sizeof(int));
+    if (bodyBytes < 0 || header[0] > SERVICE_MAX_FRAME) return false;
+    id = header[1];
+    status = header[2];
+    body.clear();
+    char chunk[4096];
+    while (bodyBytes > 0) {
+        int part = min(bodyBytes, static_cast<int>(sizeof(chunk)));
+        if (!readFully(fd, chunk, part)) return false;
+        body.append(chunk, part);
+        bodyBytes -= part;
     }
+    return true;
+}
 
-    auto start_time = std::chrono::high_resolution_clock::now();  // Get the start time of the simulation
-    bool all_arrived = false;
-    
-    while (!all_arrived) {  // Continue the simulation until all vehicles reach their destinations
-        auto current_real_time = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_real = current_real_time - start_time;
-        int current_simulation_time = static_cast<int>(elapsed_real.count());
-
-        all_arrived = true; // Check if all vehicles have reached their destinations
-        for (int i = 0; i < numVehicles; i++) {
-            if (vehicle_positions[i] < path_lengths[i] - 1) {
-                all_arrived = false;
-                break;
+/* Load generator for the routing service: numConnections clients each keep up
+ to LOAD_WINDOW route requests between random intersections in flight, until
+ numRequests have been answered in total. Reports the throughput and the
+ latencies seen by the clients, then the service's own statistics*/
+bool runLoadGenerator(const string& socketPath, int numConnections, int numRequests, unsigned int seed) {
+    const int LOAD_WINDOW = 32;
+    signal(SIGPIPE, SIG_IGN);
+    int control = connectService(socketPath);
+    if (control < 0) {
+        cerr << "Cannot connect to " << socketPath << endl;
+        return false;
+    }
+    ByteBuffer frame, body;
+    int id, status, numNodes = 0;
+    beginFrame(frame, 0, SERVICE_NODES);
+    endFrame(frame);
+    if (!writeFully(control, frame.data, frame.size) || !readResponse(control, id, status, body) || status != SERVICE_OK) {
+        cerr << "The service did not list its intersections" << endl;
+        close(control);
+        return false;
+    }
+    memcpy(&numNodes, body.data, sizeof(int));
+    if (numNodes == 0) {
+        cerr << "The service has no intersections" << endl;
+        close(control);
+        return false;
+    }
+    if (numConnections < 1) numConnections = 1;
+    if (numConnections > MAX_THREADS) numConnections = MAX_THREADS;
+
+    int* latencies = new int[numRequests > 0 ? numRequests : 1];
+    atomic<long long> found(0), notFound(0), failed(0);
+    auto client = [&](int c) {
+        int first = static_cast<int>(static_cast<long long>(numRequests) * c / numConnections);
+        int total = static_cast<int>(static_cast<long long>(numRequests) * (c + 1) / numConnections) - first;
+        chrono::steady_clock::time_point* sentAt = new chrono::steady_clock::time_point[total > 0 ? total : 1];
+        XorShiftRandom random(seed + c);
+        ByteBuffer requests, response;
+        int fd = connectService(socketPath);
+        int sent = 0, received = 0;
+        while (fd >= 0 && received < total) {
+            requests.clear();
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            for (; sent < total && sent - received < LOAD_WINDOW; sent++) { // Top up the window in one write
+                int request[5] = {4 * static_cast<int>(sizeof(int)), sent, SERVICE_ROUTE, random.below(numNodes), random.below(numNodes)};
+                requests.putInts(request, 5);
+                sentAt[sent] = now;
             }
+            if (requests.size > 0 && !writeFully(fd, requests.data, requests.size)) break;
+            int replyId, replyStatus;
+            if (!readResponse(fd, replyId, replyStatus, response) || replyId < 0 || replyId >= sent) break;
+            latencies[first + received++] = static_cast<int>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - sentAt[replyId]).count());
+            if (replyStatus == SERVICE_OK) found++;
+            else if (replyStatus == SERVICE_NOT_FOUND) notFound++;
+            else failed++;
         }
-        if (all_arrived) {
-            break;
+        for (int i = received; i < total; i++) latencies[first + i] = -1; // Never answered
+        failed += total - received;
+        if (fd >= 0) close(fd);
+        delete[] sentAt;
+    };
+
+    cout << "Sending " << numRequests << " route requests over " << numConnections << " connections to " << socketPath << endl;
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    thread* clients = new thread[numConnections];
+    for (int c = 0; c < numConnections; c++) clients[c] = thread(client, c);
+    for (int c = 0; c < numConnections; c++) clients[c].join();
+    delete[] clients;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    int answered = 0;
+    for (int i = 0; i < numRequests; i++) {
+        if (latencies[i] >= 0) latencies[answered++] = latencies[i];
+    }
+    cout << answered << " answered in " << elapsed.count() << " s (" << answered / (elapsed.count() > 0 ? elapsed.count() : 1e-9)
+         << " requests/s): " << found << " routes, " << notFound << " unreachable, " << failed << " failed" << endl;
+    cout << "Client latency: p50 " << percentile(latencies, answered, 0.50) << " us, p99 "
+         << percentile(latencies, answered, 0.99) << " us" << endl;
+    delete[] latencies;
+
+    beginFrame(frame, 1, SERVICE_STATS);
+    endFrame(frame);
+    if (writeFully(control, frame.data, frame.size) && readResponse(control, id, status, body) && status == SERVICE_OK) {
+        int stats[4];
+        ByteReader reader(body.data, body.size);
+        if (reader.getInts(stats, 4)) {
+            cout << "Service: " << stats[0] << " requests served, p50 " << stats[1] << " us, p99 " << stats[2] << " us, "
+                 << (stats[3] > 0 ? static_cast<double>(stats[0]) / stats[3] : 0.0) << " requests per batch" << endl;
         }
+    }
+    close(control);
+    return failed == 0;
+}
+#endif
+
+/* Options of a batch run (see runBatch). Every input file has the same
+ default as the menu uses*/
+struct BatchOptions {
+    string operation;      // route-all, simulate, matrix, benchmark, serve or load
+    string signalFile;
+    string roadFile;
+    string vehicleFile;
+    string emergencyFile;
+    string outputFile;     // "-" writes to stdout
+    string format;         // text or csv
+    string backend;        // matrix: dijkstra or delta, by default delta-stepping when more than one thread is given
+    string benchmark;      // kernels, delta, overlay, updates, queues or all
+    string resumeFrom;     // simulate: checkpoint to continue from
+    string socketPath;     // serve and load: the routing service's Unix domain socket
+    int threads;
+    int delta;             // 0 for the average road weight
+    int count;             // queues benchmark: number of vehicles, load: number of requests
+    bool realTime;         // simulate: sleep one second per tick like the menu does
+
+    BatchOptions() : signalFile("traffic_signal_timings.csv"), roadFile("road_network.csv"), vehicleFile("vehicles.csv"),
+                     emergencyFile("emergency_vehicles.csv"), outputFile("-"), format("text"), benchmark("all"),
+                     socketPath("traffic_routing.sock"), threads(1), delta(0), count(100000), realTime(false) {}
+};
 
-        for (int i = 0; i < numVehicles; i++) {  // Process each vehicle's movement
-            if (vehicle_positions[i] >= path_lengths[i] - 1) {
-                continue; // Skip if the vehicle has already reached its desired path xD
-            }
-
-            Nodes* current_node = vehicle_paths[i][vehicle_positions[i]];
-            Nodes* next_node = vehicle_paths[i][vehicle_positions[i] + 1];
-            int edge_weight = get_edge_weight(current_node, next_node);
-
-            if (edge_weight == -1) { // If no valid edge, show an error and skip this vehicle
-                cerr << "Invalid edge for vehicle " << vehicle[i].ID << endl;
-                continue;
-            }
-
-            int arrival_time = vehicle_departure_times[i] + edge_weight;
-
-            if (arrival_time > current_simulation_time) {  // If the vehicle hasn't reached the next node yet, skip to the next iteration
-                continue;
-            }
+void printBatchUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]            (no options starts the menu)" << endl;
+    cerr << "  --op route-all|simulate|matrix|benchmark|serve|load  Operation to run" << endl;
+    cerr << "  --signals FILE     Signal timings (default traffic_signal_timings.csv)" << endl;
+    cerr << "  --roads FILE       Road network (default road_network.csv)" << endl;
+    cerr << "  --vehicles FILE    Vehicles (default vehicles.csv)" << endl;
+    cerr << "  --emergency FILE   Emergency vehicles (default emergency_vehicles.csv)" << endl;
+    cerr << "  -o, --output FILE  Where results are written, - for stdout (default -)" << endl;
+    cerr << "  --format text|csv  Output format of route-all and matrix (default text)" << endl;
+    cerr << "  --threads N        Worker threads, 0 for every hardware thread (default 1)" << endl;
+    cerr << "  --backend dijkstra|delta  Matrix backend" << endl;
+    cerr << "  --delta N          Delta-stepping bucket width, 0 for the average road weight" << endl;
+    cerr << "  --bench kernels|delta|overlay|updates|queues|cache|all  Benchmark to run (default all)" << endl;
+    cerr << "  --count N          Vehicles of the queues benchmark, requests of load (default 100000)" << endl;
+    cerr << "  --resume FILE      Continue the simulation from a checkpoint" << endl;
+    cerr << "  --real-time        Simulate one tick per second instead of as fast as possible" << endl;
+    cerr << "  --socket PATH      Socket of the routing service (default traffic_routing.sock)" << endl;
+    cerr << "                     serve answers on it with --threads workers, load sends it --count" << endl;
+    cerr << "                     route requests over --threads connections" << endl;
+}
 
-            if (vehicle[i].priorityLevel == "High") {  // Handle emergency vehicles (high priority)
-                vehicle_positions[i]++;
-                vehicle_departure_times[i] = arrival_time + edge_weight;
-                cout << "Emergency Vehicle " << vehicle[i].ID << " moves to " << next_node->name
-                          << " at time " << current_simulation_time << " seconds." << endl;
-            } 
-            else { // Handle normal vehicles
-                if (!is_light_green(next_node, arrival_time, red_duration)) { 
-                    int wait_time = calculate_wait_time(next_node, arrival_time, red_duration);
-                    vehicle_departure_times[i] += wait_time;
-                    cout << "Vehicle " << vehicle[i].ID << " is waiting at " << next_node->name
-                              << " for " << wait_time << " seconds." << endl;
-                } 
-                else {   // Check for congestion and find an alternative path if needed
-                    if (isCongested(current_node->name, next_node->name)) {
-                        Nodes** alternative_path = bfs(current_node->name, next_node->name);
-                        if (alternative_path != nullptr) {
-                            delete[] vehicle_paths[i];
-                            vehicle_paths[i] = alternative_path;
-
-                            // Update the path length and reset the position for rerouting
-                            path_lengths[i] = 0;
-                            while (alternative_path[path_lengths[i]] != nullptr) {
-                                path_lengths[i]++;
-                            }
-                            vehicle_positions[i] = 0;
-                            vehicle_departure_times[i] = current_simulation_time;
-                        }
-                        else {
-                            cerr << "No alternative path found for vehicle " << vehicle[i].ID << endl;
-                        }
-                    } 
-                    else {
-                        vehicle_positions[i]++;
-                        vehicle_departure_times[i] = arrival_time + edge_weight;
-                        cout << "Vehicle " << vehicle[i].ID << " moves to " << next_node->name
-                                  << " at time " << current_simulation_time << " seconds." << endl;
-                    }
-                }
-            }
+bool parseBatchOptions(int argc, char** argv, BatchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--real-time") {
+            options.realTime = true;
+            continue;
         }
-
-        auto current_time = std::chrono::high_resolution_clock::now(); // Check if the simulation time has come at exact time or not
-        std::chrono::duration<double> elapsed = current_time - start_time;
-        double simulation_time = elapsed.count();
-        if (simulation_time < max_simulation_time) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));  // Simulate real time by sleeping 1 second 
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        string value = argv[++i];
+        if (arg == "--op") options.operation = value;
+        else if (arg == "--signals") options.signalFile = value;
+        else if (arg == "--roads") options.roadFile = value;
+        else if (arg == "--vehicles") options.vehicleFile = value;
+        else if (arg == "--emergency") options.emergencyFile = value;
+        else if (arg == "-o" || arg == "--output") options.outputFile = value;
+        else if (arg == "--format") options.format = value;
+        else if (arg == "--backend") options.backend = value;
+        else if (arg == "--bench") options.benchmark = value;
+        else if (arg == "--resume") options.resumeFrom = value;
+        else if (arg == "--socket") options.socketPath = value;
+        else if (arg == "--threads" || arg == "--delta" || arg == "--count") {
+            char* end;
+            long number = strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || number < 0 || number > 1000000000) {
+                cerr << "Invalid number for " << arg << ": " << value << endl;
+                return false;
+            }
+            if (arg == "--threads") options.threads = static_cast<int>(number);
+            else if (arg == "--delta") options.delta = static_cast<int>(number);
+            else options.count = static_cast<int>(number);
         } else {
-            break;
+            cerr << "Unknown option " << arg << endl;
+            return false;
         }
     }
 
-    for (int i = 0; i < numVehicles; i++) { // After the simulation, print the paths for each vehicle
-        if (vehicle_paths[i] == nullptr) {
-            cerr << "No path found for vehicle " << vehicle[i].ID << endl;
-            continue;
+    if (options.operation != "route-all" && options.operation != "simulate" && options.operation != "matrix" &&
+        options.operation != "benchmark" && options.operation != "serve" && options.operation != "load") {
+        cerr << (options.operation.empty() ? "No operation given" : "Unknown operation " + options.operation) << endl;
+        return false;
+    }
+    if (options.format != "text" && options.format != "csv") {
+        cerr << "Unknown format " << options.format << endl;
+        return false;
+    }
+    if (options.format == "csv" && options.operation != "route-all" && options.operation != "matrix") {
+        cerr << "CSV output is only available for route-all and matrix" << endl;
+        return false;
+    }
+    if (!options.backend.empty() && options.backend != "dijkstra" && options.backend != "delta") {
+        cerr << "Unknown backend " << options.backend << endl;
+        return false;
+    }
+    if (options.benchmark != "kernels" && options.benchmark != "delta" && options.benchmark != "overlay" &&
+        options.benchmark != "updates" && options.benchmark != "queues" && options.benchmark != "cache" && options.benchmark != "all") {
+        cerr << "Unknown benchmark " << options.benchmark << endl;
+        return false;
+    }
+#ifndef HAVE_UNIX_SOCKETS
+    if (options.operation == "serve" || options.operation == "load") {
+        cerr << "The routing service needs Unix domain sockets" << endl;
+        return false;
+    }
+#endif
+    if (options.threads == 0) options.threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    return true;
+}
+
+/* Runs one operation without the menu, for scripts and nightly jobs: the
+ input files and everything the menu would ask are given as options, nothing
+ is read from cin, and the results are streamed to the output file as they
+ are produced. Operations that report on cout (simulate, benchmark) have cout
+ sent to the output file. Progress and errors go to cerr. Returns the exit
+ code: 0 on success, 1 for bad options, 2 when a file can't be opened*/
+int runBatch(int argc, char** argv) {
+    BatchOptions options;
+    if (!parseBatchOptions(argc, argv, options)) {
+        printBatchUsage(argv[0]);
+        return 1;
+    }
+#ifdef HAVE_UNIX_SOCKETS
+    if (options.operation == "load") { // A client, it needs none of the input files
+        return runLoadGenerator(options.socketPath, options.threads, options.count, 2024) ? 0 : 2;
+    }
+#endif
+
+    const string* inputs[] = {&options.signalFile, &options.roadFile, &options.vehicleFile, &options.emergencyFile};
+    for (const string* input : inputs) {
+        if (!ifstream(*input).good()) { // The loaders skip missing files, a batch run must not
+            cerr << "Cannot open " << *input << endl;
+            return 2;
         }
-        cout << "Vehicle " << vehicle[i].ID << " path: ";
-        int j;
-        for (j = 0; j < path_lengths[i] - 1; j++) {
-            cout << vehicle_paths[i][j]->name << " -> ";
+    }
+    ofstream file;
+    if (options.outputFile != "-") {
+        file.open(options.outputFile, ios::trunc);
+        if (!file.good()) {
+            cerr << "Cannot write " << options.outputFile << endl;
+            return 2;
         }
-        cout << vehicle_paths[i][j]->name << " Destination Reached." << endl;
-        cout << endl;
     }
+    ostream& out = options.outputFile != "-" ? file : cout;
 
-    for (int i = 0; i < numVehicles; i++) { // Clean up memory 
-        if (vehicle_paths[i] != nullptr) {
-            delete[] vehicle_paths[i];
+    auto startTime = chrono::high_resolution_clock::now();
+    streambuf* consoleBuffer = cout.rdbuf();
+    cout.rdbuf(cerr.rdbuf()); // Warnings about the input files belong to the log, not the results
+    Vehicles vehicles;
+    vehicles.setReportEdits(false);
+    vehicles.traffic_signal_timings(options.signalFile);
+    vehicles.road_Network(options.roadFile);
+    vehicles.vehicles_csv(options.vehicleFile, options.emergencyFile);
+    chrono::duration<double> loadTime = chrono::high_resolution_clock::now() - startTime;
+    cerr << "Loaded " << vehicles.getnumNodes() << " intersections, " << vehicles.getnumEdges() << " roads and "
+         << vehicles.getnumVehicles() << " vehicles in " << loadTime.count() << " s" << endl;
+
+    cout.rdbuf(&out != &cout ? out.rdbuf() : consoleBuffer); // Reports printed on cout go with the results
+    bool csv = options.format == "csv";
+    if (options.operation == "route-all") {
+        vehicles.routeAllVehicles(out, csv, options.threads);
+        vehicles.displayRouteCacheStats(cerr);
+    } else if (options.operation == "simulate") {
+        vehicles.simulate(options.resumeFrom, options.realTime);
+    } else if (options.operation == "matrix") {
+        bool delta = options.backend.empty() ? options.threads > 1 : options.backend == "delta";
+        vehicles.displayDistanceMatrix(delta ? BACKEND_DELTA_STEPPING : BACKEND_DIJKSTRA, options.delta, options.threads, out, csv);
+    } else if (options.operation == "benchmark") {
+        bool all = options.benchmark == "all";
+        if (all || options.benchmark == "kernels") vehicles.benchmarkRelaxKernels();
+        if (all || options.benchmark == "delta") vehicles.benchmarkDeltaStepping(options.delta);
+        if (all || options.benchmark == "overlay") vehicles.benchmarkRegionOverlay(options.threads);
+        if (all || options.benchmark == "updates") vehicles.benchmarkWeightUpdates(options.threads);
+        if (all || options.benchmark == "queues") vehicles.benchmarkRoadQueues(options.count);
+        if (all || options.benchmark == "cache") vehicles.benchmarkRouteCache(options.threads);
+    } else {
+#ifdef HAVE_UNIX_SOCKETS
+        RoutingService service(vehicles, options.threads);
+        if (!service.run(options.socketPath)) {
+            cout.rdbuf(consoleBuffer);
+            return 2;
         }
+#endif
     }
-    delete[] vehicle_paths;
-    delete[] path_lengths;
-    delete[] vehicle_positions;
-    delete[] vehicle_departure_times;
+    cout.flush();
+    cout.rdbuf(consoleBuffer);
 
-    cout << "Simulation complete." << endl;
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - startTime;
+    if (!out.good()) {
+        cerr << "Writing " << options.outputFile << " failed" << endl;
+        return 2;
+    }
+    cerr << options.operation << " finished in " << elapsed.count() << " s" << endl;
+    return 0;
 }
-};
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1) return runBatch(argc, argv); // Options given, run without the menu
+
     Vehicles vehicles;
     bool running = true;
     
@@ -998,7 +6775,25 @@ int main() {
         cout << "10. Simulation" << endl;
         cout << "11. Simulate Accident/Road Closure" << endl;
         cout << "12. Reopen Road" << endl;
-        cout << "13. Exit" << endl;
+        cout << "13. Alternative Routes" << endl;
+        cout << "14. Optimize Signal Timings" << endl;
+        cout << "15. Fastest Route at Departure Time" << endl;
+        cout << "16. Benchmark Routing Kernels" << endl;
+        cout << "17. Distance Matrix" << endl;
+        cout << "18. Benchmark Parallel Delta-Stepping" << endl;
+        cout << "19. Find Vehicle" << endl;
+        cout << "20. Streaming Simulation" << endl;
+        cout << "21. Resume Simulation from Checkpoint" << endl;
+        cout << "22. What-if Scenarios (Monte Carlo)" << endl;
+        cout << "23. Reproduce Scenario" << endl;
+        cout << "24. Region Overlay Route" << endl;
+        cout << "25. Benchmark Region Overlay" << endl;
+        cout << "26. Apply Road Weight Updates" << endl;
+        cout << "27. Benchmark Weight Customization" << endl;
+        cout << "28. Benchmark Road Queues" << endl;
+        cout << "29. Route Cache Statistics" << endl;
+        cout << "30. Benchmark Route Cache" << endl;
+        cout << "31. Exit" << endl;
         cout << "Choose an option: ";
         
         int choice;
@@ -1040,25 +6835,17 @@ int main() {
                 cin >> startNode;
                 cout << "Enter the end node: ";
                 cin >> endNode;
-                int distance;
+                Distance distance;
 
-                Nodes** path = vehicles.dijkstra(startNode, endNode, distance);
+                Route path = vehicles.dijkstra(startNode, endNode, distance);
 
-                if (path == nullptr) {
+                if (!path.found()) {
                     cout << "No path found!" << endl;
                 } else {
                     cout << "Path: ";
-                    int j = 0;
-                    while (path[j] != nullptr) {
-                        cout << path[j]->name;
-                        j++;
-                        if (path[j] != nullptr) {
-                            cout << " -> ";
-                        }
-                    }
+                    vehicles.displayRoute(path);
                     cout << endl;
                     cout << "Shortest Distance: " << distance << endl;
-                    delete[] path;
                 }
                 break;
             }
@@ -1096,7 +6883,178 @@ int main() {
                 vehicles.reopenRoad(from, to);
                 break;
             }
-            case 13:
+            case 13: {
+                string startNode, endNode;
+                int k;
+                cout << "Enter the start node: ";
+                cin >> startNode;
+                cout << "Enter the end node: ";
+                cin >> endNode;
+                cout << "Enter the number of routes: ";
+                cin >> k;
+                if (k <= 0) {
+                    cout << "Number of routes must be positive!" << endl;
+                    break;
+                }
+
+                Route* routes = new Route[k];
+                long long* costs = new long long[k];
+                int found = vehicles.kAlternativeRoutes(startNode, endNode, k, routes, costs);
+                if (found == 0) {
+                    cout << "No path found!" << endl;
+                }
+                for (int r = 0; r < found; r++) {
+                    cout << "Route " << r + 1 << ": ";
+                    vehicles.displayRoute(routes[r]);
+                    cout << " (Distance: " << costs[r] << ")" << endl;
+                }
+                delete[] routes;
+                delete[] costs;
+                break;
+            }
+            case 14: {
+                vehicles.optimizeSignalTimings();
+                break;
+            }
+            case 15: {
+                string startNode, endNode;
+                int departure;
+                cout << "Enter the start node: ";
+                cin >> startNode;
+                cout << "Enter the end node: ";
+                cin >> endNode;
+                cout << "Enter the departure time (s): ";
+                cin >> departure;
+
+                Route path;
+                long long travel_time = vehicles.timeDependentRoute(startNode, endNode, departure, path);
+                if (!path.found()) {
+                    cout << "No path found!" << endl;
+                } else {
+                    cout << "Path: ";
+                    vehicles.displayRoute(path);
+                    cout << endl;
+                    cout << "Travel Time (including signal waits): " << travel_time << endl;
+                }
+                break;
+            }
+            case 16: {
+                vehicles.benchmarkRelaxKernels();
+                break;
+            }
+            case 17: {
+                int backend, delta = 0, threads = 1;
+                cout << "Backend (0 = Dijkstra, 1 = Delta-stepping): ";
+                cin >> backend;
+                if (backend == BACKEND_DELTA_STEPPING) {
+                    cout << "Enter delta (0 for the average road weight): ";
+                    cin >> delta;
+                    cout << "Enter the number of threads: ";
+                    cin >> threads;
+                }
+                vehicles.displayDistanceMatrix(backend, delta, threads);
+                break;
+            }
+            case 18: {
+                int delta;
+                cout << "Enter delta (0 for the average road weight): ";
+                cin >> delta;
+                vehicles.benchmarkDeltaStepping(delta);
+                break;
+            }
+            case 19: {
+                string id;
+                cout << "Enter Vehicle ID: ";
+                cin >> id;
+                vehicles.displayVehicle(id);
+                break;
+            }
+            case 20: {
+                string tripFile;
+                char follow;
+                int speed;
+                cout << "Enter the trip file or pipe (e.g. trip_stream.csv): ";
+                cin >> tripFile;
+                cout << "Keep watching it for new trips (y/n): ";
+                cin >> follow;
+                cout << "Enter simulated seconds per real second (0 for as fast as possible): ";
+                cin >> speed;
+                vehicles.streamingSimulation(tripFile, follow == 'y' || follow == 'Y', speed);
+                break;
+            }
+            case 21: {
+                string checkpointFile;
+                cout << "Enter the checkpoint file (e.g. simulation_checkpoint.bin): ";
+                cin >> checkpointFile;
+                vehicles.simulate(checkpointFile);
+                break;
+            }
+            case 22: {
+                int scenarios, threads, maxClosures, maxDispatches;
+                unsigned int seed;
+                cout << "Enter the number of scenarios, first seed and number of threads: ";
+                cin >> scenarios >> seed >> threads;
+                cout << "Enter the most road closures and emergency dispatches per scenario: ";
+                cin >> maxClosures >> maxDispatches;
+                vehicles.runScenarios(scenarios, seed, threads, maxClosures, maxDispatches);
+                break;
+            }
+            case 23: {
+                int maxClosures, maxDispatches;
+                unsigned int seed;
+                cout << "Enter the scenario seed: ";
+                cin >> seed;
+                cout << "Enter the most road closures and emergency dispatches per scenario: ";
+                cin >> maxClosures >> maxDispatches;
+                vehicles.reproduceScenario(seed, maxClosures, maxDispatches);
+                break;
+            }
+            case 24: {
+                string from, to;
+                cout << "Enter start and end intersections: ";
+                cin >> from >> to;
+                vehicles.overlayRoute(from, to);
+                break;
+            }
+            case 25: {
+                int threads;
+                cout << "Enter the number of customization threads: ";
+                cin >> threads;
+                vehicles.benchmarkRegionOverlay(threads);
+                break;
+            }
+            case 26: {
+                string file;
+                cout << "Enter the weight update file (e.g. traffic_updates.csv): ";
+                cin >> file;
+                vehicles.loadWeightUpdates(file);
+                break;
+            }
+            case 27: {
+                int threads;
+                cout << "Enter the number of customization threads: ";
+                cin >> threads;
+                vehicles.benchmarkWeightUpdates(threads);
+                break;
+            }
+            case 28: {
+                int count;
+                cout << "Enter the number of vehicles: ";
+                cin >> count;
+                vehicles.benchmarkRoadQueues(count);
+                break;
+            }
+            case 29:
+                vehicles.displayRouteCacheStats();
+                break;
+            case 30: {
+                int threads;
+                cout << "Enter the number of threads: ";
+                cin >> threads;
+                vehicles.benchmarkRouteCache(threads);
+                break;
+            }
+            case 31:
                 running = false;
                 break;
             default: